@@ -1,5 +1,7 @@
+import random
 import socket
 import threading
+import time
 import tkinter as tk
 from tkinter import messagebox
 import sys
@@ -17,11 +19,13 @@ class CheckersClient:
         self.player_color = None  # Kolor pionków gracza (white/black)
         self.my_pieces = None  # Znak własnych pionków
         self.opponent_pieces = None  # Znak pionków przeciwnika
+        self.session = None  # (id gry, sekret) z komunikatu SESSION, do wznowienia gry
+        self.hops_seen = 0  # liczba otrzymanych MOVE_UPDATE w bieżącej grze
 
         # Połączenie z serwerem
         try:
             self.socket.connect(('127.0.0.1', 12345))
-            connect_msg = f"CONNECT {self.player_name}"
+            connect_msg = f"CONNECT {self.player_name}\n"
             self.socket.send(connect_msg.encode())
         except Exception as e:
             messagebox.showerror("Błąd", f"Nie można połączyć z serwerem: {e}")
@@ -89,7 +93,7 @@ class CheckersClient:
             toX, toY = self.convert_coordinates(x, y)
             
             print(f"🎯 Klient wysyła ruch: ({fromX}, {fromY}) -> ({toX}, {toY})")
-            move = f"MOVE {fromX} {fromY} {toX} {toY}"
+            move = f"MOVE {fromX} {fromY} {toX} {toY}\n"
             self.socket.send(move.encode())
 
             orig_color = "#666666" if (self.selected[0] + self.selected[1]) % 2 == 1 else "#CCCCCC"
@@ -114,7 +118,7 @@ class CheckersClient:
                 try:
                     data = self.socket.recv(1024).decode()
                     if not data:
-                        break
+                        raise ConnectionError("serwer zamknął połączenie")
                     
                     print(f"Otrzymano surowe dane: '{data}'")
                     messages = data.strip().split('\n')
@@ -127,11 +131,62 @@ class CheckersClient:
 
                 except Exception as e:
                     print(f"Błąd połączenia: {e}")
-                    break
+                    if not self.resume_session():
+                        break
 
         thread = threading.Thread(target=receive, daemon=True)
         thread.start()
 
+    def resume_session(self):
+        """Po zerwaniu połączenia wznawia grę tokenem z SESSION; serwer dośle brakujące ruchy."""
+        if self.session is None:
+            return False
+        delay = 0.5
+        for attempt in range(8):
+            # Losowe opóźnienie, aby po awarii sieci klienci nie łączyli się wszyscy naraz.
+            time.sleep(delay * random.uniform(0.5, 1.5))
+            delay = min(delay * 2, 8)
+            try:
+                sock = socket.create_connection(('127.0.0.1', 12345), timeout=5)
+                sock.settimeout(None)
+                game_id, secret = self.session
+                sock.send(f"RESUME {game_id} {secret} {self.hops_seen}\n".encode())
+                self.socket = sock
+                print("🔄 Wznawianie gry...")
+                return True
+            except OSError as e:
+                print(f"Wznowienie nie powiodło się: {e}")
+        return False
+
+    def set_color(self, color):
+        """Ustawia kolor gracza i znaki pionków."""
+        self.player_color = color
+        if self.player_color == "white":
+            self.my_pieces = "●"
+            self.opponent_pieces = "○"
+            self.my_king = "♚"
+            self.opponent_king = "♔"
+        else:
+            self.my_pieces = "○"
+            self.opponent_pieces = "●"
+            self.my_king = "♔"
+            self.opponent_king = "♚"
+
+    def show_board(self, cells):
+        """Rysuje planszę z migawki BOARD (kody pól: 1/2 pionek biały/czarny, 3/4 damka)."""
+        mine_white = self.player_color == "white"
+        glyphs = {
+            0: "",
+            1: self.my_pieces if mine_white else self.opponent_pieces,
+            2: self.opponent_pieces if mine_white else self.my_pieces,
+            3: self.my_king if mine_white else self.opponent_king,
+            4: self.opponent_king if mine_white else self.my_king,
+        }
+        for i in range(8):
+            for j in range(8):
+                local_x, local_y = self.convert_coordinates(i, j)
+                self.board[local_x][local_y].configure(text=glyphs.get(cells[i * 8 + j], ""))
+
     def process_message(self, data):
         """Przetwarza wiadomości otrzymane z serwera i aktualizuje stan gry."""
         parts = data.split()
@@ -142,26 +197,12 @@ class CheckersClient:
         command = parts[0]
 
         if command == "COLOR":
-            self.player_color = parts[1]
-
-            # Ustawienie znaków pionków
-            if self.player_color == "white":
-                self.my_pieces = "●"
-                self.opponent_pieces = "○"
-                self.my_king = "♚"
-                self.opponent_king = "♔"
-                
-            else:
-                self.my_pieces = "○"
-                self.opponent_pieces = "●"
-                self.my_king = "♔"
-                self.opponent_king = "♚"
-                
-
+            self.set_color(parts[1])
             print(f"🔹 Twój kolor: {self.player_color} (Twoje pionki: {self.my_pieces})")
             self.root.after(0, self.setup_initial_pieces)
 
         elif command == "GAME_START":
+            self.hops_seen = 0
             self.is_my_turn = (self.player_color == "white")
             print("🎉 Gra rozpoczęta!")
             if self.is_my_turn:
@@ -173,6 +214,7 @@ class CheckersClient:
                 print("⚠ Błąd: Nieprawidłowy format MOVE_UPDATE")
                 return
 
+            self.hops_seen += 1
             _, fromX, fromY, toX, toY = parts[:5]
             fromX, fromY, toX, toY = int(fromX), int(fromY), int(toX), int(toY)
 
@@ -200,6 +242,29 @@ class CheckersClient:
             self.root.after(0, lambda: self.update_board(fromX, fromY, toX, toY, new_piece))
 
 
+        elif command == "SESSION":
+            self.session = (parts[1], parts[2])
+
+        elif command == "RESUMED":
+            # Kolejne MOVE_UPDATE to ruchy od numeru parts[2] albo migawka BOARD.
+            self.set_color(parts[1])
+            self.hops_seen = int(parts[2])
+            print("🔄 Gra wznowiona")
+
+        elif command == "BOARD":
+            cells = [int(value) for value in parts[1:65]]
+            self.root.after(0, lambda: self.show_board(cells))
+
+        elif command == "OPPONENT_AWAY":
+            print("⏳ Przeciwnik stracił połączenie, czekamy na jego powrót...")
+
+        elif command == "OPPONENT_BACK":
+            print("🔄 Przeciwnik wrócił do gry")
+
+        elif command == "NO_GAME_FOUND":
+            print("⚠ Serwer nie zna tej gry")
+            self.session = None
+
         elif command == "YOUR_TURN":
             self.is_my_turn = True
             print("▶ Teraz twoja kolej!")
@@ -209,6 +274,11 @@ class CheckersClient:
             self.is_my_turn = False
             print("⏳ Czekaj na ruch przeciwnika...")
 
+        elif command == "CLOCK" and len(parts) >= 3:
+            # Pozostały czas w ms; biegnie zegar strony na posunięciu.
+            white, black = (int(t) // 1000 for t in parts[1:3])
+            print(f"⏱ Zegar: białe {white // 60}:{white % 60:02d}, czarne {black // 60}:{black % 60:02d}")
+
         elif command == "INVALID_MOVE":
             print("⚠ Nieprawidłowy ruch!")
             self.root.after(0, lambda: messagebox.showwarning("Nieprawidłowy", "Nieprawidłowy ruch!"))
@@ -218,13 +288,18 @@ class CheckersClient:
             self.root.after(0, lambda: messagebox.showinfo("Gra", "Teraz nie twoja kolej!"))
 
         elif command == "GAME_OVER":
-            if len(parts) > 1:
+            self.session = None
+            if len(parts) > 1 and parts[1] == "draw":
+                messagebox.showinfo("Gra", "Gra zakończona remisem!")
+            elif len(parts) > 1:
                 winner = parts[1]
-                messagebox.showinfo("Gra", f"Gra zakończona! Wygrał: {winner}")
+                reason = " (przekroczenie czasu)" if len(parts) > 2 and parts[2] == "TIME" else ""
+                messagebox.showinfo("Gra", f"Gra zakończona! Wygrał: {winner}{reason}")
             else:
                 messagebox.showinfo("Gra", "Gra zakończona!")
 
         elif command == "OPPONENT_DISCONNECTED":
+            self.session = None
             messagebox.showinfo("Połączenie z przeciwnikiem zostało utracone")
 
 
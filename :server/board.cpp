@@ -0,0 +1,195 @@
+#include "board.h"
+
+uint32_t Board::manCaptureTargets(int sq, bool isWhite) const {
+    uint32_t enemyMask = enemy(isWhite);
+    uint32_t empty = emptySquares();
+    uint32_t targets = 0;
+    for (int dir = UP_LEFT; dir <= DOWN_RIGHT; dir++) {
+        int landing = DIAGONALS.jump[sq][dir];
+        if (landing >= 0 && (enemyMask & (1u << DIAGONALS.neighbour[sq][dir])) && (empty & (1u << landing))) {
+            targets |= 1u << landing;
+        }
+    }
+    return targets;
+}
+
+uint32_t Board::kingCaptureTargets(int sq, bool isWhite) const {
+    uint32_t occ = occupied();
+    uint32_t enemyMask = enemy(isWhite);
+    uint32_t targets = 0;
+    for (int dir = UP_LEFT; dir <= DOWN_RIGHT; dir++) {
+        int blocker, next;
+        rayUntilBlocked(sq, dir, occ, blocker);
+        if (blocker >= 0 && (enemyMask & (1u << blocker))) {
+            targets |= rayUntilBlocked(blocker, dir, occ, next);
+        }
+    }
+    return targets;
+}
+
+uint32_t Board::kingSlideTargets(int sq) const {
+    uint32_t occ = occupied();
+    uint32_t targets = 0;
+    for (int dir = UP_LEFT; dir <= DOWN_RIGHT; dir++) {
+        int blocker;
+        targets |= rayUntilBlocked(sq, dir, occ, blocker);
+    }
+    return targets;
+}
+
+uint32_t Board::quietTargets(int sq, bool isWhite) const {
+    if (kings & (1u << sq)) return kingSlideTargets(sq);
+    int firstDir = isWhite ? UP_LEFT : DOWN_LEFT;
+    uint32_t targets = 0;
+    for (int dir = firstDir; dir <= firstDir + 1; dir++) {
+        int n = DIAGONALS.neighbour[sq][dir];
+        if (n >= 0) targets |= 1u << n;
+    }
+    return targets & emptySquares();
+}
+
+uint32_t Board::captureTargets(int sq, bool isWhite) const {
+    if (kings & (1u << sq)) return kingCaptureTargets(sq, isWhite);
+    return manCaptureTargets(sq, isWhite);
+}
+
+uint32_t Board::capturingPieces(bool isWhite) const {
+    uint32_t enemyMask = enemy(isWhite);
+    uint32_t empty = emptySquares();
+    // Zwykłe pionki: pole sąsiednie zajęte przez przeciwnika i wolne pole za nim.
+    uint32_t men = own(isWhite) & ~kings;
+    uint32_t result = 0;
+    for (int dir = UP_LEFT; dir <= DOWN_RIGHT; dir++) {
+        int back = oppositeDirection(dir);
+        result |= men & shiftDiagonal(enemyMask & shiftDiagonal(empty, back), back);
+    }
+    for (uint32_t k = own(isWhite) & kings; k; k &= k - 1) {
+        int sq = __builtin_ctz(k);
+        if (kingCaptureTargets(sq, isWhite)) result |= 1u << sq;
+    }
+    return result;
+}
+
+// Zwraca pierwsze zajęte pole między polem startowym a docelowym (-1, gdy droga jest wolna).
+int Board::capturedSquare(int fromSq, int toSq) const {
+    int dir = directionBetween(fromSq, toSq);
+    if (!(DIAGONALS.ray[fromSq][dir] & (1u << toSq))) return -1;
+    uint32_t between = DIAGONALS.ray[fromSq][dir] & ~DIAGONALS.ray[toSq][dir] & ~(1u << toSq);
+    uint32_t blockers = between & occupied();
+    return blockers ? nearestOnRay(blockers, dir) : -1;
+}
+
+uint64_t Board::computeHash() const {
+    uint64_t key = 0;
+    for (uint32_t p = white | black; p; p &= p - 1) {
+        int sq = __builtin_ctz(p);
+        key ^= pieceKey(sq, white & (1u << sq), kings & (1u << sq));
+    }
+    return key;
+}
+
+int Board::playHop(int fromSq, int toSq, bool isWhite, bool& promoted) {
+    uint32_t fromBit = 1u << fromSq;
+    uint32_t toBit = 1u << toSq;
+    int captured = capturedSquare(fromSq, toSq);
+    uint32_t& ownMask = isWhite ? white : black;
+    uint32_t& enemyMask = isWhite ? black : white;
+    if (captured >= 0) {
+        hash ^= pieceKey(captured, !isWhite, kings & (1u << captured));
+        enemyMask &= ~(1u << captured);
+        kings &= ~(1u << captured);
+    }
+    bool wasKing = kings & fromBit;
+    ownMask = (ownMask & ~fromBit) | toBit;
+    promoted = false;
+    if (wasKing) {
+        kings = (kings & ~fromBit) | toBit;
+    } else if (toBit & (isWhite ? TOP_ROW : BOTTOM_ROW)) {
+        kings |= toBit;
+        promoted = true;
+    }
+    hash ^= pieceKey(fromSq, isWhite, wasKing) ^ pieceKey(toSq, isWhite, wasKing || promoted);
+    return captured;
+}
+
+void Board::addCaptureChains(bool isWhite, int sq, Move& move, MoveList& list) const {
+    for (uint32_t t = captureTargets(sq, isWhite); t; t &= t - 1) {
+        int target = __builtin_ctz(t);
+        Board next = *this;
+        bool promoted;
+        int captured = next.playHop(sq, target, isWhite, promoted);
+        move.path[move.hops++] = int8_t(target);
+        move.captured |= 1u << captured;
+        // Promocja kończy bicie, tak samo jak brak kolejnego bicia z pola lądowania.
+        if (promoted || move.hops == MAX_CAPTURE_CHAIN || !next.captureTargets(target, isWhite)) {
+            list.add(move);
+        } else {
+            next.addCaptureChains(isWhite, target, move, list);
+        }
+        move.hops--;
+        move.captured &= ~(1u << captured);
+    }
+}
+
+void Board::generateMoves(bool isWhite, int chainSquare, MoveList& list) const {
+    list.clear();
+    Move move;
+    uint32_t movers = chainSquare >= 0 ? (1u << chainSquare) : own(isWhite);
+    for (uint32_t p = capturingPieces(isWhite) & movers; p; p &= p - 1) {
+        move.from = int8_t(__builtin_ctz(p));
+        addCaptureChains(isWhite, move.from, move, list);
+    }
+    // Bicie jest obowiązkowe, a kontynuacja łańcucha dopuszcza wyłącznie bicia.
+    if (list.count > 0 || chainSquare >= 0) return;
+    move.hops = 1;
+    for (uint32_t p = movers; p; p &= p - 1) {
+        move.from = int8_t(__builtin_ctz(p));
+        for (uint32_t targets = quietTargets(move.from, isWhite); targets; targets &= targets - 1) {
+            move.path[0] = int8_t(__builtin_ctz(targets));
+            list.add(move);
+        }
+    }
+}
+
+void Board::applyMove(const Move& move, bool isWhite, UndoRecord& undo) {
+    uint32_t fromBit = 1u << move.from;
+    uint32_t toBit = 1u << move.to();
+    uint32_t& ownMask = isWhite ? white : black;
+    uint32_t& enemyMask = isWhite ? black : white;
+    undo.captured = move.captured;
+    undo.capturedKings = kings & move.captured;
+    undo.hash = hash;
+    for (uint32_t c = move.captured; c; c &= c - 1) {
+        int sq = __builtin_ctz(c);
+        hash ^= pieceKey(sq, !isWhite, undo.capturedKings & (1u << sq));
+    }
+    enemyMask &= ~move.captured;
+    kings &= ~move.captured;
+    bool wasKing = kings & fromBit;
+    ownMask = (ownMask & ~fromBit) | toBit;
+    // Promocja kończy łańcuch bić, więc może nastąpić tylko na ostatnim polu ruchu.
+    undo.promoted = false;
+    if (wasKing) {
+        kings = (kings & ~fromBit) | toBit;
+    } else if (toBit & (isWhite ? TOP_ROW : BOTTOM_ROW)) {
+        kings |= toBit;
+        undo.promoted = true;
+    }
+    hash ^= pieceKey(move.from, isWhite, wasKing) ^ pieceKey(move.to(), isWhite, wasKing || undo.promoted);
+}
+
+void Board::undoMove(const Move& move, bool isWhite, const UndoRecord& undo) {
+    uint32_t fromBit = 1u << move.from;
+    uint32_t toBit = 1u << move.to();
+    uint32_t& ownMask = isWhite ? white : black;
+    uint32_t& enemyMask = isWhite ? black : white;
+    bool wasKing = (kings & toBit) && !undo.promoted;
+    ownMask = (ownMask & ~toBit) | fromBit;
+    kings &= ~toBit;
+    if (wasKing) kings |= fromBit;
+    enemyMask |= undo.captured;
+    kings |= undo.capturedKings;
+    hash = undo.hash;
+}
+
+const Board START_BOARD = makeBoard(0xFFF00000u, 0x00000FFFu, 0);
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <stdint.h>
+
+// Plansza przechowywana jest jako bitboardy: każde z 32 ciemnych pól ma swój bit.
+// Pole o indeksie s leży w wierszu s / 4 i kolumnie 2 * (s % 4) + 1 - (s / 4) % 2,
+// więc bit 0 to pole (0,1), a bit 31 to pole (7,6).
+const uint32_t EVEN_ROWS = 0x0F0F0F0Fu;
+const uint32_t ODD_ROWS = 0xF0F0F0F0u;
+const uint32_t TOP_ROW = 0x0000000Fu;
+const uint32_t BOTTOM_ROW = 0xF0000000u;
+const uint32_t LEFT_EDGE = 0x10101010u;
+const uint32_t RIGHT_EDGE = 0x08080808u;
+
+enum Direction {
+    UP_LEFT = 0,
+    UP_RIGHT = 1,
+    DOWN_LEFT = 2,
+    DOWN_RIGHT = 3
+};
+
+constexpr int squareIndex(int x, int y) {
+    if (x < 0 || x >= 8 || y < 0 || y >= 8 || (x + y) % 2 == 0) return -1;
+    return x * 4 + y / 2;
+}
+
+constexpr int squareRow(int sq) {
+    return sq / 4;
+}
+
+constexpr int squareCol(int sq) {
+    return 2 * (sq % 4) + 1 - (sq / 4) % 2;
+}
+
+// Przesuwa wszystkie bity o jedno pole w danym kierunku. Wielkość przesunięcia zależy od
+// parzystości wiersza, a pola, które wypadłyby poza planszę, są odcinane maskami.
+inline uint32_t shiftDiagonal(uint32_t b, int dir) {
+    switch (dir) {
+        case UP_LEFT:
+            return ((b & EVEN_ROWS & ~TOP_ROW) >> 4) | ((b & ODD_ROWS & ~LEFT_EDGE) >> 5);
+        case UP_RIGHT:
+            return ((b & EVEN_ROWS & ~TOP_ROW & ~RIGHT_EDGE) >> 3) | ((b & ODD_ROWS) >> 4);
+        case DOWN_LEFT:
+            return ((b & EVEN_ROWS) << 4) | ((b & ODD_ROWS & ~BOTTOM_ROW & ~LEFT_EDGE) << 3);
+        default:
+            return ((b & EVEN_ROWS & ~RIGHT_EDGE) << 5) | ((b & ODD_ROWS & ~BOTTOM_ROW) << 4);
+    }
+}
+
+constexpr int oppositeDirection(int dir) {
+    return 3 - dir;
+}
+
+// Tablice przekątnych liczone w czasie kompilacji: dla każdego pola i kierunku sąsiad,
+// pole lądowania po skoku (-1, gdy wypada poza planszę) oraz maska całego promienia.
+struct DiagonalTables {
+    int8_t neighbour[32][4];
+    int8_t jump[32][4];
+    uint32_t ray[32][4];
+};
+
+constexpr DiagonalTables makeDiagonalTables() {
+    DiagonalTables t{};
+    const int stepX[4] = {-1, -1, 1, 1};
+    const int stepY[4] = {-1, 1, -1, 1};
+    for (int sq = 0; sq < 32; sq++) {
+        for (int dir = 0; dir < 4; dir++) {
+            int x = squareRow(sq) + stepX[dir];
+            int y = squareCol(sq) + stepY[dir];
+            t.neighbour[sq][dir] = int8_t(squareIndex(x, y));
+            t.jump[sq][dir] = int8_t(squareIndex(x + stepX[dir], y + stepY[dir]));
+            for (; squareIndex(x, y) >= 0; x += stepX[dir], y += stepY[dir]) {
+                t.ray[sq][dir] |= 1u << squareIndex(x, y);
+            }
+        }
+    }
+    return t;
+}
+
+constexpr DiagonalTables DIAGONALS = makeDiagonalTables();
+
+// Klucze Zobrista: losowa liczba dla każdego rodzaju bierki na każdym polu oraz klucz
+// oznaczający ruch czarnych. Generowane w czasie kompilacji przez splitmix64.
+struct ZobristKeys {
+    uint64_t piece[4][32];   // pionek biały, damka biała, pionek czarny, damka czarna
+    uint64_t blackToMove;
+};
+
+constexpr uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+constexpr ZobristKeys makeZobristKeys() {
+    ZobristKeys keys{};
+    uint64_t state = 0x5761726361627921ull;
+    for (int kind = 0; kind < 4; kind++) {
+        for (int sq = 0; sq < 32; sq++) keys.piece[kind][sq] = splitmix64(state);
+    }
+    keys.blackToMove = splitmix64(state);
+    return keys;
+}
+
+constexpr ZobristKeys ZOBRIST = makeZobristKeys();
+
+inline uint64_t pieceKey(int sq, bool isWhite, bool isKing) {
+    return ZOBRIST.piece[(isWhite ? 0 : 2) + (isKing ? 1 : 0)][sq];
+}
+
+// Kierunki w górę zmniejszają indeks pola, więc najbliższe pole promienia to najstarszy bit.
+inline int nearestOnRay(uint32_t squares, int dir) {
+    return dir >= DOWN_LEFT ? __builtin_ctz(squares) : 31 - __builtin_clz(squares);
+}
+
+// Pola promienia przed pierwszą przeszkodą (bez niej); zwraca też samą przeszkodę lub -1.
+inline uint32_t rayUntilBlocked(int sq, int dir, uint32_t occupied, int& blocker) {
+    uint32_t ray = DIAGONALS.ray[sq][dir];
+    uint32_t blockers = ray & occupied;
+    if (!blockers) {
+        blocker = -1;
+        return ray;
+    }
+    blocker = nearestOnRay(blockers, dir);
+    return ray & ~DIAGONALS.ray[blocker][dir] & ~(1u << blocker);
+}
+
+inline int directionBetween(int fromSq, int toSq) {
+    return (squareRow(toSq) < squareRow(fromSq) ? UP_LEFT : DOWN_LEFT) +
+           (squareCol(toSq) < squareCol(fromSq) ? 0 : 1);
+}
+
+// Najdłuższy możliwy łańcuch bić i pojemność listy ruchów; lista nie korzysta ze sterty.
+const int MAX_CAPTURE_CHAIN = 12;
+const int MAX_MOVES = 128;
+
+// Pełny ruch strony na posunięciu: pole startowe, kolejne pola lądowania i zbite pionki.
+struct Move {
+    int8_t from = -1;
+    uint8_t hops = 0;
+    int8_t path[MAX_CAPTURE_CHAIN];
+    uint32_t captured = 0;
+
+    int to() const { return path[hops - 1]; }
+    bool isCapture() const { return captured != 0; }
+};
+
+struct MoveList {
+    Move moves[MAX_MOVES];
+    int count = 0;
+    bool truncated = false;
+
+    void clear() { count = 0; truncated = false; }
+    void add(const Move& move) {
+        if (count < MAX_MOVES) moves[count++] = move;
+        else truncated = true;
+    }
+    const Move* begin() const { return moves; }
+    const Move* end() const { return moves + count; }
+};
+
+// Zapis potrzebny do cofnięcia pełnego ruchu: zbite pionki (w tym damki) i flaga promocji.
+// Liczby pionków są liczone z masek, więc nie trzeba ich zapamiętywać.
+struct UndoRecord {
+    uint32_t captured = 0;
+    uint32_t capturedKings = 0;
+    bool promoted = false;
+    uint64_t hash = 0;
+};
+
+// Stan planszy: białe pionki, czarne pionki i maska damek (obu kolorów).
+struct Board {
+    uint32_t white = 0;
+    uint32_t black = 0;
+    uint32_t kings = 0;
+    uint64_t hash = 0;   // klucz Zobrista układu bierek, bez strony na posunięciu
+
+    uint32_t occupied() const { return white | black; }
+    uint32_t emptySquares() const { return ~(white | black); }
+    uint32_t own(bool isWhite) const { return isWhite ? white : black; }
+    uint32_t enemy(bool isWhite) const { return isWhite ? black : white; }
+    uint64_t computeHash() const;
+
+    uint32_t manCaptureTargets(int sq, bool isWhite) const;
+    uint32_t kingCaptureTargets(int sq, bool isWhite) const;
+    uint32_t kingSlideTargets(int sq) const;
+    uint32_t quietTargets(int sq, bool isWhite) const;
+    uint32_t captureTargets(int sq, bool isWhite) const;
+    uint32_t capturingPieces(bool isWhite) const;
+    int capturedSquare(int fromSq, int toSq) const;
+    // Wykonuje pojedynczy skok lub przesunięcie; zwraca zbite pole (-1, gdy brak bicia).
+    int playHop(int fromSq, int toSq, bool isWhite, bool& promoted);
+    // Generuje wszystkie ruchy strony; chainSquare >= 0 oznacza kontynuację bicia tym pionkiem.
+    void generateMoves(bool isWhite, int chainSquare, MoveList& list) const;
+    // Wykonuje pełny ruch z generatora w miejscu i zapisuje, jak go cofnąć; bez kopii i alokacji.
+    void applyMove(const Move& move, bool isWhite, UndoRecord& undo);
+    void undoMove(const Move& move, bool isWhite, const UndoRecord& undo);
+
+private:
+    void addCaptureChains(bool isWhite, int sq, Move& move, MoveList& list) const;
+};
+
+inline Board makeBoard(uint32_t white, uint32_t black, uint32_t kings) {
+    Board board;
+    board.white = white;
+    board.black = black;
+    board.kings = kings;
+    board.hash = board.computeHash();
+    return board;
+}
+
+// Pozycja startowa: czarne zajmują wiersze 0-2 (bity 0-11), białe wiersze 5-7 (bity 20-31).
+extern const Board START_BOARD;
@@ -0,0 +1,129 @@
+#include "book.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "logger.h"
+
+OpeningBook::~OpeningBook() {
+    if (mapped) munmap(mapped, mappedSize);
+}
+
+bool OpeningBook::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+        close(fd);
+        return false;
+    }
+    size_t size = size_t(info.st_size);
+    void* data = size >= BOOK_HEADER_SIZE ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (data == MAP_FAILED) {
+        LOG_ERROR("Nie można zmapować księgi otwarć %s", path.c_str());
+        return false;
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t slotCount, entries;
+    uint32_t maxPly;
+    memcpy(&slotCount, bytes + 8, sizeof(slotCount));
+    memcpy(&entries, bytes + 16, sizeof(entries));
+    memcpy(&maxPly, bytes + 24, sizeof(maxPly));
+    if (memcmp(bytes, BOOK_MAGIC, sizeof(BOOK_MAGIC)) != 0 || slotCount == 0 || (slotCount & (slotCount - 1)) != 0 ||
+        entries >= slotCount || (size - BOOK_HEADER_SIZE) / sizeof(BookEntry) < slotCount) {
+        LOG_ERROR("Plik %s nie jest poprawną księgą otwarć", path.c_str());
+        munmap(data, size);
+        return false;
+    }
+    // Sondy trafiają w losowe sloty; odczyt z wyprzedzeniem tylko zajmowałby pamięć.
+    madvise(data, size, MADV_RANDOM);
+    mapped = data;
+    mappedSize = size;
+    slots = reinterpret_cast<const BookEntry*>(bytes + BOOK_HEADER_SIZE);
+    mask = slotCount - 1;
+    shift = 64 - __builtin_ctzll(slotCount);
+    entryCount = size_t(entries);
+    plies = int(maxPly);
+    LOG_INFO("Księga otwarć %s: %zu pozycji do półruchu %d, %zu MB", path.c_str(), entryCount, plies, size >> 20);
+    return true;
+}
+
+const BookEntry* OpeningBook::find(uint64_t key) const {
+    if (!slots || key == 0) return nullptr;
+    for (uint64_t i = bookSlot(key, shift);; i = (i + 1) & mask) {
+        const BookEntry& entry = slots[i];
+        if (entry.key == key) return &entry;
+        if (entry.key == 0) return nullptr;
+    }
+}
+
+int OpeningBook::bookMoves(const Board& board, bool isWhite, BookMove* out, int capacity) const {
+    if (!slots) return 0;
+    MoveList moves;
+    board.generateMoves(isWhite, -1, moves);
+    int count = 0;
+    for (const Move& move : moves) {
+        Board next = board;
+        UndoRecord undo;
+        next.applyMove(move, isWhite, undo);
+        const BookEntry* entry = find(positionKey(next, !isWhite));
+        if (entry && count < capacity) out[count++] = {move, *entry};
+    }
+    std::sort(out, out + count, [](const BookMove& a, const BookMove& b) { return a.stats.games > b.stats.games; });
+    return count;
+}
+
+static bool writeAll(int fd, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        ssize_t written = ::write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        bytes += written;
+        size -= size_t(written);
+    }
+    return true;
+}
+
+bool OpeningBook::write(const std::string& path, const std::vector<BookEntry>& entries, int maxPly) {
+    // Wypełnienie najwyżej 3/4, więc nieudane wyszukiwanie kończy się po kilku slotach.
+    uint64_t slotCount = 16;
+    while (slotCount * 3 / 4 < entries.size() + 1) slotCount *= 2;
+    std::vector<BookEntry> table(slotCount, BookEntry{0, 0, 0, 0, 0});
+    uint64_t tableMask = slotCount - 1;
+    int tableShift = 64 - __builtin_ctzll(slotCount);
+    uint64_t stored = 0;
+    for (const BookEntry& entry : entries) {
+        if (entry.key == 0) continue;
+        uint64_t i = bookSlot(entry.key, tableShift);
+        while (table[i].key != 0) i = (i + 1) & tableMask;
+        table[i] = entry;
+        stored++;
+    }
+    uint8_t header[BOOK_HEADER_SIZE] = {};
+    uint32_t ply = uint32_t(maxPly);
+    memcpy(header, BOOK_MAGIC, sizeof(BOOK_MAGIC));
+    memcpy(header + 8, &slotCount, sizeof(slotCount));
+    memcpy(header + 16, &stored, sizeof(stored));
+    memcpy(header + 24, &ply, sizeof(ply));
+
+    std::string tmpPath = path + ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool ok = writeAll(fd, header, sizeof(header)) && writeAll(fd, table.data(), table.size() * sizeof(BookEntry));
+    ok = ok && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "board.h"
+
+// Księga otwarć: statystyki pozycji z archiwum partii, kluczowane kluczem Zobrista pozycji
+// ze stroną na posunięciu (Game::getHash). Plik to nagłówek i tablica z adresowaniem otwartym
+// (sondowanie liniowe od slotu bookSlot, liczba slotów to potęga dwójki, klucz 0 to pusty slot),
+// mapowana przez mmap tylko do odczytu i czytana bez kopiowania przez wszystkie gry i wątki. Otwarcie
+// sprawdza tylko nagłówek, więc trwa tyle samo przy tysiącu i przy dziesiątkach milionów
+// pozycji; strony pliku wczytuje dopiero pierwsze trafienie w nie.
+//
+// Format: BOOK_MAGIC, uint64 liczba slotów, uint64 liczba pozycji, uint32 największy półruch,
+// zera do BOOK_HEADER_SIZE, potem sloty BookEntry (little-endian, jak na serwerze).
+const char BOOK_MAGIC[8] = {'W', 'A', 'R', 'C', 'B', 'O', 'O', 'K'};
+const size_t BOOK_HEADER_SIZE = 64;
+
+struct BookEntry {
+    uint64_t key;
+    uint32_t games;
+    uint32_t whiteWins;
+    uint32_t blackWins;
+    uint32_t reserved;
+
+    uint32_t draws() const { return games - whiteWins - blackWins; }
+};
+static_assert(sizeof(BookEntry) == 24, "BookEntry jest zapisywany w pliku bez przepakowania");
+
+// Ruch z pozycji do pozycji obecnej w księdze, ze statystykami pozycji po ruchu.
+struct BookMove {
+    Move move;
+    BookEntry stats;
+};
+
+class OpeningBook {
+public:
+    ~OpeningBook();
+    bool open(const std::string& path);
+    bool loaded() const { return slots != nullptr; }
+    size_t size() const { return entryCount; }
+    int maxPly() const { return plies; }
+    const BookEntry* find(uint64_t key) const;
+    // Ruchy strony isWhite prowadzące do pozycji z księgi, od najczęściej granych; zwraca ich liczbę.
+    int bookMoves(const Board& board, bool isWhite, BookMove* out, int capacity) const;
+    // Buduje tablicę z wpisów o różnych kluczach i zapisuje ją obok, a potem przez rename.
+    static bool write(const std::string& path, const std::vector<BookEntry>& entries, int maxPly);
+
+private:
+    const BookEntry* slots = nullptr;
+    uint64_t mask = 0;
+    int shift = 64;
+    size_t entryCount = 0;
+    int plies = 0;
+    void* mapped = nullptr;
+    size_t mappedSize = 0;
+};
+
+// Haszowanie Fibonacciego: starsze bity iloczynu zależą od wszystkich bitów klucza, więc
+// układ tablicy nie zależy od tego, jak dobrze rozłożone są młodsze bity.
+inline uint64_t bookSlot(uint64_t key, int shift) {
+    return (key * 0x9E3779B97F4A7C15ull) >> shift;
+}
+
+inline uint64_t positionKey(const Board& board, bool whiteToMove) {
+    return board.hash ^ (whiteToMove ? 0 : ZOBRIST.blackToMove);
+}
@@ -0,0 +1,253 @@
+#include "endgame.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "logger.h"
+
+// Pola, na których może stać pionek: białe nie stoją w wierszu 0, czarne w wierszu 7.
+static const uint32_t BLACK_ONLY = TOP_ROW;
+static const uint32_t SHARED = ~(TOP_ROW | BOTTOM_ROW);
+static const int SHARED_SQUARES = 24;
+static const int ROW_SQUARES = 4;
+
+struct BinomialTable {
+    uint64_t value[33][33];
+};
+
+constexpr BinomialTable makeBinomials() {
+    BinomialTable t{};
+    for (int n = 0; n <= 32; n++) {
+        t.value[n][0] = 1;
+        for (int k = 1; k <= n; k++) t.value[n][k] = t.value[n - 1][k - 1] + (k < n ? t.value[n - 1][k] : 0);
+    }
+    return t;
+}
+
+static constexpr BinomialTable BINOMIALS = makeBinomials();
+
+static uint64_t choose(int n, int k) {
+    return k < 0 || n < 0 || k > n ? 0 : BINOMIALS.value[n][k];
+}
+
+// Numer kombinacji set wśród pól available w porządku colex; set musi zawierać się w available.
+static uint64_t rankSubset(uint32_t set, uint32_t available) {
+    uint64_t rank = 0;
+    for (int i = 1; set; set &= set - 1, i++) {
+        int position = __builtin_popcount(available & ((1u << __builtin_ctz(set)) - 1));
+        rank += choose(position, i);
+    }
+    return rank;
+}
+
+// Pole o numerze position wśród ustawionych bitów available.
+static uint32_t selectBit(uint32_t available, int position) {
+    while (position-- > 0) available &= available - 1;
+    return available & -available;
+}
+
+static uint32_t unrankSubset(uint64_t rank, int count, uint32_t available) {
+    uint32_t set = 0;
+    int limit = __builtin_popcount(available);
+    for (int i = count; i >= 1; i--) {
+        int position = i - 1;
+        while (position + 1 < limit && choose(position + 1, i) <= rank) position++;
+        rank -= choose(position, i);
+        set |= selectBit(available, position);
+        limit = position;
+    }
+    return set;
+}
+
+// Liczba układów pionków, w których k czarnych pionków stoi na polach wspólnych.
+static uint64_t menBlock(const Material& m, int k) {
+    return choose(ROW_SQUARES, m.blackMen - k) * choose(SHARED_SQUARES, k) *
+           choose(SHARED_SQUARES + ROW_SQUARES - k, m.whiteMen);
+}
+
+static int firstBlock(const Material& m) {
+    return m.blackMen > ROW_SQUARES ? m.blackMen - ROW_SQUARES : 0;
+}
+
+Material materialOf(const Board& board) {
+    Material m;
+    m.whiteMen = __builtin_popcount(board.white & ~board.kings);
+    m.whiteKings = __builtin_popcount(board.white & board.kings);
+    m.blackMen = __builtin_popcount(board.black & ~board.kings);
+    m.blackKings = __builtin_popcount(board.black & board.kings);
+    return m;
+}
+
+uint64_t tablebaseSize(const Material& m) {
+    uint64_t men = 0;
+    for (int k = firstBlock(m); k <= m.blackMen; k++) men += menBlock(m, k);
+    int free = 32 - m.whiteMen - m.blackMen;
+    return men * choose(free, m.whiteKings) * choose(free - m.whiteKings, m.blackKings);
+}
+
+uint64_t tablebaseIndex(const Board& board, const Material& m) {
+    uint32_t whiteMen = board.white & ~board.kings;
+    uint32_t blackMen = board.black & ~board.kings;
+    uint32_t whiteKings = board.white & board.kings;
+    uint32_t blackKings = board.black & board.kings;
+    int k = __builtin_popcount(blackMen & SHARED);
+    uint64_t men = 0;
+    for (int j = firstBlock(m); j < k; j++) men += menBlock(m, j);
+    uint64_t blackRank = rankSubset(blackMen & BLACK_ONLY, BLACK_ONLY) * choose(SHARED_SQUARES, k) +
+                         rankSubset(blackMen & SHARED, SHARED);
+    uint32_t whiteSquares = ~BLACK_ONLY & ~blackMen;
+    men += blackRank * choose(SHARED_SQUARES + ROW_SQUARES - k, m.whiteMen) + rankSubset(whiteMen, whiteSquares);
+
+    uint32_t free = ~(whiteMen | blackMen);
+    int freeCount = 32 - m.whiteMen - m.blackMen;
+    uint64_t index = men * choose(freeCount, m.whiteKings) + rankSubset(whiteKings, free);
+    return index * choose(freeCount - m.whiteKings, m.blackKings) + rankSubset(blackKings, free & ~whiteKings);
+}
+
+Board tablebasePosition(const Material& m, uint64_t index) {
+    int freeCount = 32 - m.whiteMen - m.blackMen;
+    uint64_t blackKingCombos = choose(freeCount - m.whiteKings, m.blackKings);
+    uint64_t whiteKingCombos = choose(freeCount, m.whiteKings);
+    uint64_t blackKingRank = index % blackKingCombos;
+    index /= blackKingCombos;
+    uint64_t whiteKingRank = index % whiteKingCombos;
+    uint64_t men = index / whiteKingCombos;
+
+    int k = firstBlock(m);
+    while (men >= menBlock(m, k)) men -= menBlock(m, k++);
+    uint64_t whiteCombos = choose(SHARED_SQUARES + ROW_SQUARES - k, m.whiteMen);
+    uint64_t whiteRank = men % whiteCombos;
+    men /= whiteCombos;
+    uint32_t blackMen = unrankSubset(men % choose(SHARED_SQUARES, k), k, SHARED) |
+                        unrankSubset(men / choose(SHARED_SQUARES, k), m.blackMen - k, BLACK_ONLY);
+    uint32_t whiteMen = unrankSubset(whiteRank, m.whiteMen, ~BLACK_ONLY & ~blackMen);
+    uint32_t free = ~(whiteMen | blackMen);
+    uint32_t whiteKings = unrankSubset(whiteKingRank, m.whiteKings, free);
+    uint32_t blackKings = unrankSubset(blackKingRank, m.blackKings, free & ~whiteKings);
+    return makeBoard(whiteMen | whiteKings, blackMen | blackKings, whiteKings | blackKings);
+}
+
+static uint32_t reverseBits(uint32_t b) {
+    b = ((b >> 1) & 0x55555555u) | ((b & 0x55555555u) << 1);
+    b = ((b >> 2) & 0x33333333u) | ((b & 0x33333333u) << 2);
+    b = ((b >> 4) & 0x0F0F0F0Fu) | ((b & 0x0F0F0F0Fu) << 4);
+    return __builtin_bswap32(b);
+}
+
+// Obrót planszy o 180 stopni to odwrócenie kolejności 32 bitów pól.
+Board flipBoard(const Board& board) {
+    return makeBoard(reverseBits(board.black), reverseBits(board.white), reverseBits(board.kings));
+}
+
+EndgameTablebase::~EndgameTablebase() {
+    if (mapped) munmap(mapped, mappedSize);
+}
+
+int EndgameTablebase::materialKey(const Material& m) {
+    const int base = TABLEBASE_MAX_PIECES + 1;
+    return ((m.whiteMen * base + m.whiteKings) * base + m.blackMen) * base + m.blackKings;
+}
+
+static uint32_t readU32(const uint8_t* p) {
+    return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+static uint64_t readU64(const uint8_t* p) {
+    return uint64_t(readU32(p)) | uint64_t(readU32(p + 4)) << 32;
+}
+
+bool EndgameTablebase::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+        close(fd);
+        return false;
+    }
+    size_t size = size_t(info.st_size);
+    void* data = size >= 16 ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (data == MAP_FAILED) {
+        LOG_ERROR("Nie można zmapować bazy końcówek %s", path.c_str());
+        return false;
+    }
+    // Sondy trafiają w losowe miejsca pliku, więc odczyt z wyprzedzeniem tylko szkodzi.
+    madvise(data, size, MADV_RANDOM);
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint32_t pieces = readU32(bytes + 8);
+    uint32_t count = readU32(bytes + 12);
+    bool ok = memcmp(bytes, TABLEBASE_MAGIC, sizeof(TABLEBASE_MAGIC)) == 0 &&
+              pieces <= uint32_t(TABLEBASE_MAX_PIECES) && 16 + uint64_t(count) * 24 <= size;
+    for (uint32_t i = 0; ok && i < count; i++) {
+        const uint8_t* entry = bytes + 16 + i * 24;
+        Material m{entry[0], entry[1], entry[2], entry[3]};
+        uint64_t offset = readU64(entry + 8);
+        uint64_t length = readU64(entry + 16);
+        ok = m.pieces() <= int(pieces) && length == tablebaseSize(m) && offset <= size && length <= size - offset;
+        if (ok) tables[materialKey(m)] = bytes + offset;
+    }
+    if (!ok) {
+        LOG_ERROR("Plik %s nie jest poprawną bazą końcówek", path.c_str());
+        for (auto& table : tables) table = nullptr;
+        munmap(data, size);
+        return false;
+    }
+    mapped = data;
+    mappedSize = size;
+    maxPieces = int(pieces);
+    LOG_INFO("Baza końcówek %s: %u tablic, do %u bierek, %zu MB", path.c_str(), count, pieces, size >> 20);
+    return true;
+}
+
+void EndgameTablebase::attach(const Material& material, const uint8_t* data) {
+    tables[materialKey(material)] = data;
+    if (material.pieces() > maxPieces) maxPieces = material.pieces();
+}
+
+bool EndgameTablebase::contains(const Material& material) const {
+    return material.pieces() <= maxPieces && tables[materialKey(material)] != nullptr;
+}
+
+TablebaseProbe EndgameTablebase::probe(const Board& board, bool isWhite) const {
+    TablebaseProbe probe;
+    Board position = isWhite ? board : flipBoard(board);
+    // Strona bez bierek już przegrała; odwrotny przypadek nie powstaje w trakcie gry.
+    if (position.white == 0) {
+        probe.result = TB_LOSS;
+        return probe;
+    }
+    if (position.black == 0 || __builtin_popcount(position.occupied()) > maxPieces) return probe;
+    Material m = materialOf(position);
+    const uint8_t* table = tables[materialKey(m)];
+    if (!table) return probe;
+    return decodeTablebaseValue(table[tablebaseIndex(position, m)]);
+}
+
+bool EndgameTablebase::bestMove(const Board& board, bool isWhite, Move& move, TablebaseProbe& result) const {
+    MoveList moves;
+    board.generateMoves(isWhite, -1, moves);
+    if (moves.count == 0 || moves.truncated) return false;
+    int bestScore = 0;
+    bool found = false;
+    for (const Move& candidate : moves) {
+        Board next = board;
+        UndoRecord undo;
+        next.applyMove(candidate, isWhite, undo);
+        TablebaseProbe reply = probe(next, !isWhite);
+        if (reply.result == TB_UNKNOWN) return false;
+        // Wynik z punktu widzenia strony na posunięciu: szybka wygrana, remis, długa obrona.
+        int score = reply.result == TB_LOSS ? 1000 - reply.distance
+                  : reply.result == TB_DRAW ? 0 : -1000 + reply.distance;
+        if (!found || score > bestScore) {
+            found = true;
+            bestScore = score;
+            move = candidate;
+            result.result = reply.result == TB_LOSS ? TB_WIN : reply.result == TB_DRAW ? TB_DRAW : TB_LOSS;
+            result.distance = reply.result == TB_DRAW ? 0 : reply.distance + 1;
+        }
+    }
+    return found;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+#include "board.h"
+
+// Baza końcówek: dla każdego układu materiału (pionki i damki obu stron) tablica z jednym
+// bajtem na pozycję z białymi na posunięciu. Pozycje z czarnymi na posunięciu są czytane
+// z tablicy materiału odwróconego o 180 stopni z zamianą kolorów, więc zapisujemy tylko połowę.
+//
+// Indeks jest doskonały: każda liczba z zakresu [0, rozmiar) to dokładnie jeden dozwolony
+// układ bierek. Kolejno: czarne pionki (k z nich na polach wspólnych 4-27, reszta w wierszu 0),
+// białe pionki na polach 4-31 nie zajętych przez czarne, białe damki i czarne damki na
+// pozostałych polach; każda grupa to numer kombinacji (colex) wśród dostępnych pól.
+//
+// Bajt pozycji: 0 remis, d+1 (d = 0..253) wynik rozstrzygnięty po d półruchach przy
+// najlepszej grze obu stron; d nieparzyste to wygrana strony na posunięciu, parzyste przegrana.
+//
+// Format pliku: nagłówek TABLEBASE_MAGIC, uint32 największa liczba bierek, uint32 liczba tablic,
+// katalog wpisów {uint8 wm, wk, bm, bk, uint32 zero, uint64 przesunięcie, uint64 rozmiar}
+// i dane tablic wyrównane do 64 bajtów. Liczby zapisane są w porządku little-endian.
+const char TABLEBASE_MAGIC[8] = {'W', 'A', 'R', 'C', 'T', 'B', '0', '1'};
+const int TABLEBASE_MAX_PIECES = 8;
+const uint8_t TABLEBASE_DRAW = 0;
+const int TABLEBASE_MAX_DISTANCE = 253;
+
+struct Material {
+    int whiteMen = 0;
+    int whiteKings = 0;
+    int blackMen = 0;
+    int blackKings = 0;
+
+    int pieces() const { return whiteMen + whiteKings + blackMen + blackKings; }
+    Material flipped() const { return {blackMen, blackKings, whiteMen, whiteKings}; }
+    bool operator==(const Material& other) const {
+        return whiteMen == other.whiteMen && whiteKings == other.whiteKings &&
+               blackMen == other.blackMen && blackKings == other.blackKings;
+    }
+};
+
+Material materialOf(const Board& board);
+// Liczba pozycji materiału z białymi na posunięciu.
+uint64_t tablebaseSize(const Material& material);
+uint64_t tablebaseIndex(const Board& board, const Material& material);
+Board tablebasePosition(const Material& material, uint64_t index);
+// Obrót o 180 stopni z zamianą kolorów: pozycja czarnych na posunięciu staje się pozycją białych.
+Board flipBoard(const Board& board);
+
+enum TablebaseResult {
+    TB_UNKNOWN = 0,   // materiału nie ma w bazie
+    TB_WIN,
+    TB_DRAW,
+    TB_LOSS
+};
+
+struct TablebaseProbe {
+    TablebaseResult result = TB_UNKNOWN;
+    int distance = 0;   // półruchy do końca gry (dla remisu 0)
+};
+
+// Baza tylko do odczytu: plik mapowany przez mmap i współdzielony przez wszystkie wątki i gry.
+// Sondowanie to wyliczenie indeksu i odczyt jednego bajtu, bez blokad i alokacji.
+class EndgameTablebase {
+public:
+    ~EndgameTablebase();
+    bool open(const std::string& path);
+    bool loaded() const { return maxPieces > 0; }
+    int pieces() const { return maxPieces; }
+    // Podpina tablicę w pamięci (generator buduje kolejne materiały na podstawie gotowych).
+    void attach(const Material& material, const uint8_t* data);
+    bool contains(const Material& material) const;
+    // Pozycja na granicy tur (bez rozpoczętego łańcucha bić) ze stroną isWhite na posunięciu.
+    TablebaseProbe probe(const Board& board, bool isWhite) const;
+    // Najlepszy ruch według bazy: najkrótsza wygrana, utrzymanie remisu albo najdłuższa obrona.
+    bool bestMove(const Board& board, bool isWhite, Move& move, TablebaseProbe& result) const;
+
+private:
+    static const int MATERIAL_KEYS = (TABLEBASE_MAX_PIECES + 1) * (TABLEBASE_MAX_PIECES + 1) *
+                                     (TABLEBASE_MAX_PIECES + 1) * (TABLEBASE_MAX_PIECES + 1);
+    const uint8_t* tables[MATERIAL_KEYS] = {};
+    int maxPieces = 0;
+    void* mapped = nullptr;
+    size_t mappedSize = 0;
+
+    static int materialKey(const Material& material);
+};
+
+// Zamienia bajt z tablicy na wynik z punktu widzenia strony na posunięciu.
+inline TablebaseProbe decodeTablebaseValue(uint8_t value) {
+    TablebaseProbe probe;
+    if (value == TABLEBASE_DRAW) {
+        probe.result = TB_DRAW;
+    } else {
+        probe.distance = value - 1;
+        probe.result = probe.distance % 2 ? TB_WIN : TB_LOSS;
+    }
+    return probe;
+}
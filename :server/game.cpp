@@ -0,0 +1,248 @@
+#include "game.h"
+
+#include "logger.h"
+
+Game::Game(PlayerId p1, PlayerId p2) {
+    reset(p1, p2);
+}
+
+void Game::initializeBoard() {
+    board = START_BOARD;
+}
+
+// Przywraca pozycję startową obiektu z puli; nie alokuje pamięci.
+void Game::reset(PlayerId p1, PlayerId p2) {
+    initializeBoard();
+    currentPlayer = 1;
+    chainSquare = -1;
+    player1 = p1;
+    player2 = p2;
+    legalMovesValid = false;
+    historyCount = 0;
+    recordPosition(board.hash);
+    turnIrreversible = false;
+    drawn = false;
+}
+
+void Game::setPosition(const Board& position, bool whiteToMove) {
+    board = position;
+    currentPlayer = whiteToMove ? 1 : 2;
+    chainSquare = -1;
+    legalMovesValid = false;
+    historyCount = 0;
+    recordPosition(getHash());
+    turnIrreversible = false;
+    drawn = false;
+}
+
+// Dopisuje pozycję do historii i zwraca, ile razy w niej wystąpiła, łącznie z tym razem.
+int Game::recordPosition(uint64_t key) {
+    int stored = historyCount < REPETITION_WINDOW ? historyCount : REPETITION_WINDOW;
+    int occurrences = 1;
+    for (int i = 0; i < stored; i++) occurrences += history[i] == key;
+    history[historyCount % REPETITION_WINDOW] = key;
+    historyCount++;
+    return occurrences;
+}
+
+bool Game::checkGameEnd() {
+    if (drawn) {
+        LOG_INFO("Gra zakończona: remis");
+        return true;
+    }
+    if (board.white == 0) {
+        LOG_INFO("Gra zakończona: Czarny wygrywa!");
+        return true;
+    }
+    if (board.black == 0) {
+        LOG_INFO("Gra zakończona: Biały wygrywa!");
+        return true;
+    }
+    return false;
+}
+
+void Game::setCurrentPlayer(int player) {
+    currentPlayer = player;
+}
+
+void Game::printBoard() {
+    LOG_DEBUG("Aktualna plansza:");
+    for (int i = 0; i < BOARD_SIZE; i++) {
+        std::string row;
+        for (int j = 0; j < BOARD_SIZE; j++) {
+            int piece = getPieceAt(i, j);
+            if (piece == WHITE_PIECE) row += "○ ";
+            else if (piece == BLACK_PIECE) row += "● ";
+            else if (piece == WHITE_KING) row += "♚ ";
+            else if (piece == BLACK_KING) row += "♔ ";
+            else row += ". ";
+        }
+        LOG_DEBUG("%s", row.c_str());
+    }
+}
+
+std::string Game::getBoardState() const {
+    std::string state(BOARD_SIZE * BOARD_SIZE * 2, ' ');
+    for (int i = 0; i < BOARD_SIZE; i++) {
+        for (int j = 0; j < BOARD_SIZE; j++) {
+            state[(i * BOARD_SIZE + j) * 2] = char('0' + getPieceAt(i, j));
+        }
+    }
+    return state;
+}
+
+// 32 pola po 4 bity (kody jak w Piece): pole 2k w młodszym półbajcie bajtu k, 2k+1 w starszym.
+void Game::getPackedBoard(uint8_t packed[16]) const {
+    for (int i = 0; i < 16; i++) packed[i] = 0;
+    for (int sq = 0; sq < 32; sq++) {
+        uint32_t bit = 1u << sq;
+        bool king = board.kings & bit;
+        uint8_t piece = (board.white & bit) ? (king ? WHITE_KING : WHITE_PIECE)
+                      : (board.black & bit) ? (king ? BLACK_KING : BLACK_PIECE) : EMPTY;
+        packed[sq / 2] |= piece << ((sq % 2) * 4);
+    }
+}
+
+const MoveList& Game::getLegalMoves(bool isWhite) {
+    if (!legalMovesValid || legalMovesForWhite != isWhite) {
+        board.generateMoves(isWhite, chainSquare, legalMoves);
+        legalMovesValid = true;
+        legalMovesForWhite = isWhite;
+    }
+    return legalMoves;
+}
+
+std::vector<std::pair<int, int>> Game::getAvailableCaptures(int x, int y, bool isWhite) {
+    std::vector<std::pair<int, int>> captures;
+    int sq = squareIndex(x, y);
+    if (sq < 0) return captures;
+    for (uint32_t t = board.captureTargets(sq, isWhite); t; t &= t - 1) {
+        int target = __builtin_ctz(t);
+        captures.push_back({squareRow(target), squareCol(target)});
+    }
+    return captures;
+}
+
+std::vector<std::pair<int, int>> Game::getAllAvailableCaptures(bool isWhite) {
+    std::vector<std::pair<int, int>> allCaptures;
+    for (uint32_t p = board.capturingPieces(isWhite); p; p &= p - 1) {
+        int sq = __builtin_ctz(p);
+        auto captures = getAvailableCaptures(squareRow(sq), squareCol(sq), isWhite);
+        allCaptures.insert(allCaptures.end(), captures.begin(), captures.end());
+    }
+    return allCaptures;
+}
+
+bool Game::hasAnyCapture(bool isWhite) const {
+    return board.capturingPieces(isWhite) != 0;
+}
+
+bool Game::isValidMove(int fromX, int fromY, int toX, int toY, bool isWhite) {
+    LOG_DEBUG("Sprawdzanie ruchu: (%d,%d) -> (%d,%d) dla %s", fromX, fromY, toX, toY, isWhite ? "białego" : "czarnego");
+    if (fromX < 0 || fromX >= BOARD_SIZE || fromY < 0 || fromY >= BOARD_SIZE ||
+        toX < 0 || toX >= BOARD_SIZE || toY < 0 || toY >= BOARD_SIZE) {
+        LOG_DEBUG("Błąd: Ruch poza planszą");
+        return false;
+    }
+    int fromSq = squareIndex(fromX, fromY);
+    int toSq = squareIndex(toX, toY);
+    if (toSq < 0 || !(board.emptySquares() & (1u << toSq))) {
+        LOG_DEBUG("Błąd: Pole docelowe nie jest puste");
+        return false;
+    }
+    int piece = getPieceAt(fromX, fromY);
+    LOG_DEBUG("Wartość pionka na polu (%d,%d) = %d", fromX, fromY, piece);
+    if (piece == EMPTY) {
+        LOG_DEBUG("Błąd: Brak pionka na polu startowym");
+        return false;
+    }
+    if (!(board.own(isWhite) & (1u << fromSq))) {
+        LOG_DEBUG("Błąd: Nieprawidłowy kolor pionka (piece=%d, isWhite=%d)", piece, isWhite);
+        return false;
+    }
+    // Pojedynczy skok jest poprawny, jeśli rozpoczyna któryś z pełnych ruchów z listy.
+    const MoveList& moves = getLegalMoves(isWhite);
+    for (const Move& move : moves) {
+        if (move.from == fromSq && move.path[0] == toSq) {
+            LOG_DEBUG("Prawidłowy ruch%s", move.isCapture() ? " z biciem" : "");
+            return true;
+        }
+    }
+    if (moves.truncated && (chainSquare < 0 || chainSquare == fromSq)) {
+        // Przepełniona lista: sprawdzamy sam skok bezpośrednio na planszy.
+        uint32_t targets = board.capturingPieces(isWhite) ? board.captureTargets(fromSq, isWhite)
+                                                          : board.quietTargets(fromSq, isWhite);
+        if (targets & (1u << toSq)) return true;
+    }
+    if (chainSquare >= 0) {
+        LOG_DEBUG("Błąd: Musisz kontynuować bicie pionkiem z pola (%d,%d)", squareRow(chainSquare), squareCol(chainSquare));
+    } else if (moves.count > 0 && moves.moves[0].isCapture()) {
+        LOG_DEBUG("Błąd: Musisz wykonać dostępne bicie");
+    } else {
+        LOG_DEBUG("Błąd: Nieprawidłowy ruch");
+    }
+    return false;
+}
+
+void Game::makeMove(int fromX, int fromY, int toX, int toY, PlayerId player) {
+    int fromSq = squareIndex(fromX, fromY);
+    int toSq = squareIndex(toX, toY);
+    bool isWhite = (player == player1);
+    LOG_DEBUG("Poruszany pionek (movedPiece) = %d", getPieceAt(fromX, fromY));
+    if (!(board.kings & (1u << fromSq))) turnIrreversible = true;
+    bool promoted;
+    int capturedSq = board.playHop(fromSq, toSq, isWhite, promoted);
+    if (capturedSq >= 0) turnIrreversible = true;
+    if (capturedSq >= 0) {
+        LOG_DEBUG("Zbicie pionka na pozycji (%d,%d)", squareRow(capturedSq), squareCol(capturedSq));
+    }
+    if (promoted) {
+        LOG_DEBUG("Promocja na damkę! Kolor: %s", isWhite ? "biały" : "czarny");
+    }
+    // Po biciu bez promocji ten sam pionek kontynuuje, jeśli ma kolejne bicie.
+    chainSquare = (capturedSq >= 0 && !promoted && board.captureTargets(toSq, isWhite)) ? toSq : -1;
+    legalMovesValid = false;
+    if (chainSquare < 0) {
+        // Koniec tury: liczymy pozycję z przeciwnikiem na posunięciu.
+        if (turnIrreversible) historyCount = 0;
+        turnIrreversible = false;
+        uint64_t key = board.hash ^ (isWhite ? ZOBRIST.blackToMove : 0);
+        if (recordPosition(key) >= 3) drawn = true;
+    }
+    if (LOG_ENABLED(LEVEL_DEBUG)) printBoard();
+}
+
+int Game::getCurrentPlayer() const {
+    return currentPlayer;
+}
+
+PlayerId Game::getOpponent(PlayerId player) const {
+    return (player == player1) ? player2 : player1;
+}
+
+PlayerId Game::getPlayer1() const {
+    return player1;
+}
+
+
+bool Game::isKingAt(int x, int y) {
+    int sq = squareIndex(x, y);
+    return sq >= 0 && (board.kings & (1u << sq));
+}
+
+std::pair<int, int> Game::getCapturedCoordinatesForKing(int fromX, int fromY, int toX, int toY) {
+    int fromSq = squareIndex(fromX, fromY);
+    int toSq = squareIndex(toX, toY);
+    int sq = (fromSq >= 0 && toSq >= 0) ? board.capturedSquare(fromSq, toSq) : -1;
+    if (sq >= 0) return {squareRow(sq), squareCol(sq)};
+    return { (fromX + toX) / 2, (fromY + toY) / 2 };
+}
+
+int Game::getPieceAt(int x, int y) const {
+    int sq = squareIndex(x, y);
+    if (sq < 0) return EMPTY;
+    uint32_t bit = 1u << sq;
+    if (board.white & bit) return (board.kings & bit) ? WHITE_KING : WHITE_PIECE;
+    if (board.black & bit) return (board.kings & bit) ? BLACK_KING : BLACK_PIECE;
+    return EMPTY;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "board.h"
+
+// Gracze są internowani przy CONNECT do gęstych identyfikatorów; ścieżka ruchu porównuje liczby.
+using PlayerId = uint32_t;
+const PlayerId NO_PLAYER = UINT32_MAX;
+
+class Game {
+public:
+    // Udostępnione wartości, aby można było je używać poza klasą.
+    enum Piece {
+        BOARD_SIZE = 8,
+        EMPTY = 0,
+        WHITE_PIECE = 1,
+        BLACK_PIECE = 2,
+        WHITE_KING = 3,
+        BLACK_KING = 4
+    };
+
+private:
+    Board board;
+    int currentPlayer;
+    int chainSquare = -1;   // pole pionka, który musi kontynuować bicie
+    PlayerId player1, player2;
+    // Lista ruchów liczona raz na posunięcie i unieważniana przez makeMove.
+    MoveList legalMoves;
+    bool legalMovesValid = false;
+    bool legalMovesForWhite = true;
+    // Pozycje (klucz Zobrista ze stroną na posunięciu) od ostatniego nieodwracalnego ruchu;
+    // bicie lub ruch pionka czyści je, bo wcześniejsze pozycje nie mogą się powtórzyć. Okno jest
+    // krótkie, więc wystarcza stała tablica przeglądana liniowo; przy dłuższej serii ruchów damek
+    // najstarsze wpisy są nadpisywane.
+    static const int REPETITION_WINDOW = 128;
+    uint64_t history[REPETITION_WINDOW];
+    int historyCount = 0;
+    bool turnIrreversible = false;
+    bool drawn = false;
+
+    void initializeBoard();
+    int recordPosition(uint64_t key);
+
+public:
+    Game() : Game(NO_PLAYER, NO_PLAYER) {}
+    Game(PlayerId p1, PlayerId p2);
+    void reset(PlayerId p1, PlayerId p2);
+    // Ustawia dowolną pozycję (analiza, testy); gra liczy powtórzenia od tego miejsca.
+    void setPosition(const Board& position, bool whiteToMove);
+    bool checkGameEnd();
+    void setCurrentPlayer(int player);
+    void printBoard();
+    std::string getBoardState() const;
+    void getPackedBoard(uint8_t packed[16]) const;
+    const MoveList& getLegalMoves(bool isWhite);
+    std::vector<std::pair<int, int>> getAvailableCaptures(int x, int y, bool isWhite);
+    std::vector<std::pair<int, int>> getAllAvailableCaptures(bool isWhite);
+    bool hasAnyCapture(bool isWhite) const;
+    bool isValidMove(int fromX, int fromY, int toX, int toY, bool isWhite);
+    void makeMove(int fromX, int fromY, int toX, int toY, PlayerId player);
+    bool isCaptureChainPending() const { return chainSquare >= 0; }
+    int getCurrentPlayer() const;
+    PlayerId getOpponent(PlayerId player) const;
+    PlayerId getPlayer1() const;
+    bool isKingAt(int x, int y);
+    std::pair<int, int> getCapturedCoordinatesForKing(int fromX, int fromY, int toX, int toY);
+    int getPieceAt(int x, int y) const;
+    const Board& getBoard() const { return board; }
+    int getChainSquare() const { return chainSquare; }
+    uint64_t getHash() const { return board.hash ^ (currentPlayer == 2 ? ZOBRIST.blackToMove : 0); }
+    bool isDraw() const { return drawn; }
+    // Remis orzeczony z zewnątrz (np. pozycja remisowa w bazie końcówek).
+    void declareDraw() { drawn = true; }
+    int getWhiteCount() const { return __builtin_popcount(board.white); };
+    int getBlackCount() const { return __builtin_popcount(board.black); };
+
+};
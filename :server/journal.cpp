@@ -0,0 +1,263 @@
+#include "journal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <unordered_map>
+
+#include "logger.h"
+#include "metrics.h"
+
+static const size_t RECORD_HEADER_SIZE = 8;
+
+// FNV-1a złożone do 16 bitów; wystarcza do wykrycia urwanego lub nadpisanego rekordu.
+static uint16_t recordChecksum(const uint8_t* header, const uint8_t* payload, uint8_t length) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < 6; i++) hash = (hash ^ header[i]) * 16777619u;
+    for (int i = 0; i < length; i++) hash = (hash ^ payload[i]) * 16777619u;
+    return uint16_t(hash ^ (hash >> 16));
+}
+
+void encodeJournalRecord(std::vector<uint8_t>& out, uint32_t game, JournalRecordType type,
+                         const uint8_t* payload, uint8_t length) {
+    uint8_t header[RECORD_HEADER_SIZE] = {uint8_t(game), uint8_t(game >> 8), uint8_t(game >> 16), uint8_t(game >> 24),
+                                          uint8_t(type), length, 0, 0};
+    uint16_t check = recordChecksum(header, payload, length);
+    header[6] = uint8_t(check);
+    header[7] = uint8_t(check >> 8);
+    out.insert(out.end(), header, header + RECORD_HEADER_SIZE);
+    out.insert(out.end(), payload, payload + length);
+}
+
+static bool writeAll(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        size -= size_t(written);
+    }
+    return true;
+}
+
+bool MoveJournal::recover(const std::string& path, std::vector<JournalGame>& games, uint32_t& nextId) {
+    games.clear();
+    nextId = 1;
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return errno == ENOENT;
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+        close(fd);
+        return false;
+    }
+    size_t size = size_t(info.st_size);
+    if (size < JOURNAL_HEADER_SIZE) {
+        close(fd);
+        return size == 0;
+    }
+    // Cały plik jest mapowany i czytany sekwencyjnie, bez kopiowania do buforów.
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return false;
+    madvise(mapped, size, MADV_SEQUENTIAL);
+    const uint8_t* data = static_cast<const uint8_t*>(mapped);
+    if (memcmp(data, JOURNAL_MAGIC, JOURNAL_HEADER_SIZE) != 0) {
+        munmap(mapped, size);
+        LOG_ERROR("Plik %s nie jest dziennikiem ruchów", path.c_str());
+        return false;
+    }
+
+    std::unordered_map<uint32_t, size_t> live;   // identyfikator gry -> indeks w games
+    size_t pos = JOURNAL_HEADER_SIZE;
+    size_t records = 0;
+    while (pos + RECORD_HEADER_SIZE <= size) {
+        const uint8_t* header = data + pos;
+        uint8_t length = header[5];
+        if (pos + RECORD_HEADER_SIZE + length > size) break;
+        const uint8_t* payload = header + RECORD_HEADER_SIZE;
+        uint16_t check = uint16_t(header[6] | (header[7] << 8));
+        if (check != recordChecksum(header, payload, length)) break;
+        uint32_t game = uint32_t(header[0]) | uint32_t(header[1]) << 8 | uint32_t(header[2]) << 16 |
+                        uint32_t(header[3]) << 24;
+        if (game >= nextId) nextId = game + 1;
+        switch (header[4]) {
+            case JOURNAL_START: {
+                JournalGame entry;
+                entry.id = game;
+                size_t at = 0;
+                if (length >= 1) entry.botLevel = payload[at++];
+                for (std::string& name : entry.names) {
+                    if (at >= length || at + 1 + payload[at] > length) break;
+                    name.assign(reinterpret_cast<const char*>(payload + at + 1), payload[at]);
+                    at += 1 + payload[at];
+                }
+                live[game] = games.size();
+                games.push_back(std::move(entry));
+                break;
+            }
+            case JOURNAL_HOP: {
+                auto it = live.find(game);
+                if (it != live.end() && length == 2) {
+                    games[it->second].hops.push_back(payload[0]);
+                    games[it->second].hops.push_back(payload[1]);
+                }
+                break;
+            }
+            case JOURNAL_END: {
+                auto it = live.find(game);
+                if (it != live.end()) {
+                    games[it->second].id = 0;   // oznaczona do usunięcia
+                    live.erase(it);
+                }
+                break;
+            }
+        }
+        pos += RECORD_HEADER_SIZE + length;
+        records++;
+    }
+    if (pos < size) {
+        LOG_WARN("Dziennik %s: pominięto %zu bajtów urwanego zapisu na końcu", path.c_str(), size - pos);
+    }
+    munmap(mapped, size);
+    games.erase(std::remove_if(games.begin(), games.end(), [](const JournalGame& g) { return g.id == 0; }),
+                games.end());
+    LOG_INFO("Dziennik %s: %zu rekordów, %zu trwających gier", path.c_str(), records, games.size());
+    return true;
+}
+
+bool MoveJournal::rewrite(const std::string& path, const std::vector<JournalGame>& games) {
+    std::string tmpPath = path + ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    std::vector<uint8_t> buffer(JOURNAL_MAGIC, JOURNAL_MAGIC + JOURNAL_HEADER_SIZE);
+    bool ok = true;
+    for (const JournalGame& game : games) {
+        uint8_t payload[255];
+        size_t length = 0;
+        payload[length++] = game.botLevel;
+        for (const std::string& name : game.names) {
+            size_t n = std::min<size_t>(name.size(), JOURNAL_MAX_NAME);
+            payload[length++] = uint8_t(n);
+            memcpy(payload + length, name.data(), n);
+            length += n;
+        }
+        encodeJournalRecord(buffer, game.id, JOURNAL_START, payload, uint8_t(length));
+        for (size_t i = 0; i + 1 < game.hops.size(); i += 2) {
+            encodeJournalRecord(buffer, game.id, JOURNAL_HOP, &game.hops[i], 2);
+        }
+        if (buffer.size() > (1 << 20)) {
+            ok = ok && writeAll(fd, buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+    ok = ok && writeAll(fd, buffer.data(), buffer.size());
+    ok = ok && fdatasync(fd) == 0;
+    close(fd);
+    if (!ok || rename(tmpPath.c_str(), path.c_str()) < 0) {
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    // rename jest trwały dopiero po fsync katalogu; bez tego awaria może przywrócić stary plik.
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int dirFd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dirFd < 0) return false;
+    ok = fsync(dirFd) == 0;
+    close(dirFd);
+    return ok;
+}
+
+bool MoveJournal::open(const std::string& path, uint32_t firstGameId) {
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size == 0) {
+        writeAll(fd, reinterpret_cast<const uint8_t*>(JOURNAL_MAGIC), JOURNAL_HEADER_SIZE);
+    }
+    nextGameId.store(firstGameId);
+    writer = std::thread(&MoveJournal::run, this);
+    return true;
+}
+
+MoveJournal::~MoveJournal() {
+    if (!writer.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    ready.notify_one();
+    writer.join();
+    close(fd);
+}
+
+void MoveJournal::append(uint32_t game, JournalRecordType type, const uint8_t* payload, uint8_t length) {
+    bool wake;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (pending.size() >= JOURNAL_MAX_PENDING) {
+            metricCount(COUNTER_JOURNAL_STALLS);
+            LOG_WARN("Bufor dziennika ruchów pełny (%zu bajtów), czekam na zapis", pending.size());
+            drained.wait(lock, [this] { return pending.size() < JOURNAL_MAX_PENDING; });
+        }
+        wake = pending.empty();
+        encodeJournalRecord(pending, game, type, payload, length);
+    }
+    metricCount(COUNTER_JOURNAL_RECORDS);
+    if (wake) ready.notify_one();
+}
+
+void MoveJournal::logStart(uint32_t game, uint8_t botLevel, const std::string& white, const std::string& black) {
+    if (fd < 0) return;
+    uint8_t payload[255];
+    size_t length = 0;
+    payload[length++] = botLevel;
+    for (const std::string* name : {&white, &black}) {
+        size_t n = std::min<size_t>(name->size(), JOURNAL_MAX_NAME);
+        payload[length++] = uint8_t(n);
+        memcpy(payload + length, name->data(), n);
+        length += n;
+    }
+    append(game, JOURNAL_START, payload, uint8_t(length));
+}
+
+void MoveJournal::logHop(uint32_t game, int fromSq, int toSq) {
+    if (fd < 0) return;
+    uint8_t payload[2] = {uint8_t(fromSq), uint8_t(toSq)};
+    append(game, JOURNAL_HOP, payload, 2);
+}
+
+void MoveJournal::logEnd(uint32_t game) {
+    if (fd < 0) return;
+    append(game, JOURNAL_END, nullptr, 0);
+}
+
+// Group commit: wszystko, co przyszło w czasie poprzedniego fdatasync, idzie jednym zapisem.
+void MoveJournal::run() {
+    std::vector<uint8_t> batch;
+    bool failed = false;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (pending.empty() && stopping) return;
+            batch.swap(pending);
+        }
+        drained.notify_all();
+        uint64_t start = metricsNow();
+        bool ok = writeAll(fd, batch.data(), batch.size()) && fdatasync(fd) == 0;
+        metricRecord(HIST_JOURNAL_SYNC, metricsNow() - start);
+        metricCount(COUNTER_JOURNAL_BATCHES);
+        if (!ok && !failed) {
+            LOG_ERROR("Zapis dziennika ruchów nie powiódł się: %s", strerror(errno));
+        }
+        failed = !ok;
+        batch.clear();
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Dziennik ruchów (write-ahead): każda zaakceptowana zmiana stanu gry to zwarty rekord
+// binarny dopisywany na koniec pliku. Wątki gier tylko dokładają rekord do bufora w pamięci;
+// osobny wątek zapisuje zebrane rekordy jednym write i jednym fdatasync (group commit),
+// więc serwer nie czeka na dysk. Awaria może zgubić co najwyżej rekordy z ostatniej partii.
+//
+// Format pliku: nagłówek JOURNAL_MAGIC, potem rekordy:
+//   uint32 gra, uint8 typ, uint8 długość danych, uint16 suma kontrolna, dane.
+// Rekord z błędną sumą kończy odczyt (urwany zapis przy awarii).
+enum JournalRecordType : uint8_t {
+    JOURNAL_START = 1,   // [poziom komputera, długość nazwy 1, nazwa 1, długość nazwy 2, nazwa 2]
+    JOURNAL_HOP = 2,     // [skąd, dokąd] - pojedynczy skok, jak komenda MOVE
+    JOURNAL_END = 3      // gra zakończona lub porzucona; nie jest odtwarzana
+};
+
+const char JOURNAL_MAGIC[8] = {'W', 'A', 'R', 'C', 'J', 'R', 'N', '1'};
+const size_t JOURNAL_HEADER_SIZE = 8;
+// Dane rekordu mają najwyżej 255 bajtów, więc rekord startu mieści dwie nazwy po 126 bajtów.
+// Serwer nie przyjmuje dłuższych nazw, żeby gra po odtworzeniu trafiła do tego samego gracza.
+const size_t JOURNAL_MAX_NAME = 126;
+// Górna granica bufora czekającego na zapis; pełny bufor wstrzymuje dopisujących do końca
+// bieżącego fdatasync, zamiast rosnąć bez końca przy wolnym dysku.
+const size_t JOURNAL_MAX_PENDING = 4 * 1024 * 1024;
+
+// Gra odczytana z dziennika, która nie ma rekordu końca.
+struct JournalGame {
+    uint32_t id = 0;
+    uint8_t botLevel = 0;
+    std::string names[2];
+    std::vector<uint8_t> hops;   // pary (skąd, dokąd) kolejnych skoków
+};
+
+class MoveJournal {
+public:
+    ~MoveJournal();
+    // Odczyt przez mmap; zwraca gry bez rekordu końca oraz pierwszy wolny identyfikator gry.
+    // Brak pliku to pusta lista, nie błąd.
+    static bool recover(const std::string& path, std::vector<JournalGame>& games, uint32_t& nextId);
+    // Zastępuje dziennik zwartą wersją z samymi trwającymi grami (zapis obok i rename).
+    static bool rewrite(const std::string& path, const std::vector<JournalGame>& games);
+
+    bool open(const std::string& path, uint32_t firstGameId);
+    bool enabled() const { return fd >= 0; }
+    uint32_t newGameId() { return nextGameId.fetch_add(1, std::memory_order_relaxed); }
+
+    void logStart(uint32_t game, uint8_t botLevel, const std::string& white, const std::string& black);
+    void logHop(uint32_t game, int fromSq, int toSq);
+    void logEnd(uint32_t game);
+
+private:
+    int fd = -1;
+    std::atomic<uint32_t> nextGameId{1};
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::condition_variable drained;   // wątek zapisu zabrał bufor pending
+    std::vector<uint8_t> pending;
+    bool stopping = false;
+    std::thread writer;
+
+    void append(uint32_t game, JournalRecordType type, const uint8_t* payload, uint8_t length);
+    void run();
+};
+
+// Koduje rekord dziennika na koniec bufora.
+void encodeJournalRecord(std::vector<uint8_t>& out, uint32_t game, JournalRecordType type,
+                         const uint8_t* payload, uint8_t length);
@@ -0,0 +1,73 @@
+#include "logger.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <chrono>
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger() {
+    for (size_t i = 0; i < CAPACITY; i++) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    drainThread = std::thread(&Logger::drain, this);
+}
+
+Logger::~Logger() {
+    stopping.store(true);
+    if (drainThread.joinable()) drainThread.join();
+}
+
+void Logger::write(LogLevel level, const char* format, ...) {
+    uint64_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &slots[pos % CAPACITY];
+        uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        int64_t diff = int64_t(sequence) - int64_t(pos);
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    va_list args;
+    va_start(args, format);
+    vsnprintf(slot->text, sizeof(slot->text), format, args);
+    va_end(args);
+    slot->level = level;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+void Logger::drain() {
+    static const char* const names[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+    while (true) {
+        bool written = false;
+        while (true) {
+            Slot& slot = slots[dequeuePos % CAPACITY];
+            if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1) break;
+            fprintf(stdout, "[%s] %s\n", names[slot.level], slot.text);
+            slot.sequence.store(dequeuePos + CAPACITY, std::memory_order_release);
+            dequeuePos++;
+            written = true;
+        }
+        uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+        if (lost) {
+            fprintf(stdout, "[WARN] Bufor logów pełny, pominięto %llu komunikatów\n", (unsigned long long)lost);
+            written = true;
+        }
+        if (written) {
+            fflush(stdout);
+        } else if (stopping.load()) {
+            return;
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+
+// Poziomy logowania. Komunikaty poniżej LOG_MIN_LEVEL są usuwane już podczas kompilacji
+// (domyślnie wszystkie DEBUG razem z obliczaniem argumentów; zostawia je opcja CMake WARCABY_DEBUG_LOG),
+// a poziom w czasie działania (domyślnie INFO) wybiera opcja --log-level.
+enum LogLevel {
+    LEVEL_DEBUG = 0,
+    LEVEL_INFO = 1,
+    LEVEL_WARN = 2,
+    LEVEL_ERROR = 3
+};
+
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LEVEL_INFO
+#endif
+
+// Asynchroniczny logger: wątki formatują komunikat prosto do slotu w pierścieniowym
+// buforze bez blokad (kolejka MPMC z numerami sekwencyjnymi), a osobny wątek zapisuje
+// zebrane wpisy na stdout. Gdy bufor jest pełny, komunikat jest pomijany i zliczany.
+class Logger {
+public:
+    static Logger& instance();
+    bool enabled(LogLevel level) const { return level >= runtimeLevel.load(std::memory_order_relaxed); }
+    void setLevel(LogLevel level) { runtimeLevel.store(level, std::memory_order_relaxed); }
+    void write(LogLevel level, const char* format, ...) __attribute__((format(printf, 3, 4)));
+    ~Logger();
+
+private:
+    static const size_t CAPACITY = 4096;
+    struct Slot {
+        std::atomic<uint64_t> sequence;
+        LogLevel level;
+        char text[248];
+    };
+
+    Slot slots[CAPACITY];
+    std::atomic<uint64_t> enqueuePos{0};
+    uint64_t dequeuePos = 0;
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<int> runtimeLevel{LEVEL_INFO};
+    std::atomic<bool> stopping{false};
+    std::thread drainThread;
+
+    Logger();
+    void drain();
+};
+
+#define LOG_AT(level, ...)                                                          \
+    do {                                                                            \
+        if ((level) >= LOG_MIN_LEVEL && Logger::instance().enabled(level))         \
+            Logger::instance().write(level, __VA_ARGS__);                           \
+    } while (0)
+#define LOG_ENABLED(level) ((level) >= LOG_MIN_LEVEL && Logger::instance().enabled(level))
+#define LOG_DEBUG(...) LOG_AT(LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LEVEL_ERROR, __VA_ARGS__)
@@ -0,0 +1,53 @@
+#include "metrics.h"
+
+#include <algorithm>
+
+Metrics& Metrics::instance() {
+    static Metrics metrics;
+    return metrics;
+}
+
+ThreadMetrics* Metrics::registerThread() {
+    std::lock_guard<std::mutex> lock(mutex);
+    threads.push_back(std::make_unique<ThreadMetrics>());
+    return threads.back().get();
+}
+
+uint64_t Metrics::counter(MetricCounter counter) {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t sum = 0;
+    for (const auto& thread : threads) sum += thread->counters[counter].load(std::memory_order_relaxed);
+    return sum;
+}
+
+// Scala kubełki wszystkich wątków i odczytuje percentyle jako górne granice kubełków.
+HistogramSummary Metrics::summarize(MetricHistogram histogram) {
+    std::vector<uint64_t> merged(HISTOGRAM_BUCKETS, 0);
+    HistogramSummary summary;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& thread : threads) {
+            const ThreadMetrics::Histogram& h = thread->histograms[histogram];
+            for (int i = 0; i < HISTOGRAM_BUCKETS; i++) merged[i] += h.buckets[i].load(std::memory_order_relaxed);
+            summary.totalNanos += h.total.load(std::memory_order_relaxed);
+            summary.max = std::max(summary.max, h.max.load(std::memory_order_relaxed));
+        }
+    }
+    for (uint64_t n : merged) summary.count += n;
+    if (summary.count == 0) return summary;
+    // Rangi liczone w górę, aby p999 z małej próbki nie wypadało poniżej p99.
+    uint64_t rank50 = (summary.count * 500 + 999) / 1000;
+    uint64_t rank99 = (summary.count * 990 + 999) / 1000;
+    uint64_t rank999 = (summary.count * 999 + 999) / 1000;
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        if (merged[i] == 0) continue;
+        uint64_t before = seen;
+        seen += merged[i];
+        uint64_t limit = std::min(histogramBucketLimit(i), summary.max);
+        if (before < rank50 && seen >= rank50) summary.p50 = limit;
+        if (before < rank99 && seen >= rank99) summary.p99 = limit;
+        if (before < rank999 && seen >= rank999) summary.p999 = limit;
+    }
+    return summary;
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Liczniki zdarzeń; sumowane ze wszystkich wątków przy odczycie.
+enum MetricCounter {
+    COUNTER_CONNECTIONS_ACCEPTED,
+    COUNTER_CONNECTIONS_CLOSED,
+    COUNTER_PLAYERS_JOINED,
+    COUNTER_PLAYERS_LEFT,
+    COUNTER_INVALID_MOVES,
+    COUNTER_BYTES_SENT,
+    COUNTER_WATCHERS_JOINED,
+    COUNTER_WATCHERS_LEFT,
+    COUNTER_WATCHERS_DROPPED,    // obserwatorzy rozłączeni za zaległości w kolejce
+    COUNTER_LOCK_PLAYERS,        // wszystkie zajęcia playersMutex
+    COUNTER_LOCK_SESSION,        // wszystkie zajęcia mutexu sesji gry
+    COUNTER_LOCK_GAME_TABLE,     // wszystkie zajęcia mutexu sharda tablicy gier
+    COUNTER_RESUMES_DELTA,       // RESUME obsłużone dosłaniem brakujących skoków
+    COUNTER_RESUMES_SNAPSHOT,    // RESUME obsłużone migawką planszy
+    COUNTER_GRACE_EXPIRED,       // gry zakończone, bo gracz nie wrócił w okresie karencji
+    COUNTER_JOURNAL_RECORDS,     // rekordy dopisane do dziennika ruchów
+    COUNTER_JOURNAL_BATCHES,     // zapisy zakończone fdatasync (group commit)
+    COUNTER_JOURNAL_STALLS,      // dopisania wstrzymane, bo bufor dziennika był pełny
+    COUNTER_FLAG_FALLS,          // gry przegrane na czas
+    COUNTER_IDLE_CLOSED,         // połączenia zamknięte po czasie bezczynności
+    COUNTER_TABLEBASE_MOVES,     // ruchy komputera wzięte z bazy końcówek
+    COUNTER_TABLEBASE_DRAWS,     // gry zakończone remisem orzeczonym z bazy końcówek
+    COUNTER_BOOK_MOVES,          // ruchy komputera wzięte z księgi otwarć
+    COUNTER_COUNT
+};
+
+// Histogramy czasów w nanosekundach. Pierwsze pozycje to czas obsługi komend, w kolejności
+// MetricCommand; czasy oczekiwania na mutexy są zapisywane tylko wtedy, gdy mutex był zajęty.
+enum MetricHistogram {
+    HIST_COMMAND_CONNECT,
+    HIST_COMMAND_MOVE,
+    HIST_COMMAND_BOARD,
+    HIST_COMMAND_PLAY_BOT,
+    HIST_COMMAND_STATS,
+    HIST_COMMAND_WATCH,
+    HIST_COMMAND_RESUME,
+    HIST_COMMAND_BOOK,
+    HIST_COMMAND_UNKNOWN,
+    HIST_MOVE_VALIDATION,        // Game::isValidMove
+    HIST_MAKE_MOVE,              // Game::makeMove
+    HIST_SEND,                   // writev kolejki wychodzącej
+    HIST_MATCH_WAIT,             // od CONNECT do dobrania pary
+    HIST_JOURNAL_SYNC,           // write + fdatasync jednej partii dziennika
+    HIST_WAIT_PLAYERS,
+    HIST_WAIT_SESSION,
+    HIST_WAIT_GAME_TABLE,
+    HIST_COUNT
+};
+
+enum MetricCommand {
+    COMMAND_CONNECT,
+    COMMAND_MOVE,
+    COMMAND_BOARD,
+    COMMAND_PLAY_BOT,
+    COMMAND_STATS,
+    COMMAND_WATCH,
+    COMMAND_RESUME,
+    COMMAND_BOOK,
+    COMMAND_UNKNOWN,
+    COMMAND_COUNT
+};
+
+// Histogram logarytmiczno-liniowy w stylu HDR: 16 kubełków na każdą potęgę dwójki, więc
+// błąd względny odczytu nie przekracza 1/16. Zakres do 2^40 ns (ok. 18 minut).
+const int HISTOGRAM_SUB_BITS = 4;
+const int HISTOGRAM_SUB_BUCKETS = 1 << HISTOGRAM_SUB_BITS;
+const int HISTOGRAM_MAX_EXPONENT = 40;
+const int HISTOGRAM_BUCKETS = (HISTOGRAM_MAX_EXPONENT - HISTOGRAM_SUB_BITS + 2) * HISTOGRAM_SUB_BUCKETS;
+
+inline int histogramBucket(uint64_t value) {
+    if (value < uint64_t(HISTOGRAM_SUB_BUCKETS)) return int(value);
+    int exponent = 63 - __builtin_clzll(value);
+    if (exponent > HISTOGRAM_MAX_EXPONENT) return HISTOGRAM_BUCKETS - 1;
+    int shift = exponent - HISTOGRAM_SUB_BITS;
+    return (shift + 1) * HISTOGRAM_SUB_BUCKETS + int(value >> shift) - HISTOGRAM_SUB_BUCKETS;
+}
+
+// Największa wartość, która trafia do danego kubełka.
+inline uint64_t histogramBucketLimit(int bucket) {
+    if (bucket < HISTOGRAM_SUB_BUCKETS) return uint64_t(bucket);
+    int shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+    uint64_t base = uint64_t(HISTOGRAM_SUB_BUCKETS + bucket % HISTOGRAM_SUB_BUCKETS);
+    return ((base + 1) << shift) - 1;
+}
+
+// Dane jednego wątku. Zapisuje je tylko właściciel (load + store bez instrukcji z blokadą
+// magistrali), a odczyt STATS czyta je równolegle; zmienne atomowe chronią przed rozdarciem.
+struct ThreadMetrics {
+    std::atomic<uint64_t> counters[COUNTER_COUNT] = {};
+    struct Histogram {
+        std::atomic<uint64_t> buckets[HISTOGRAM_BUCKETS] = {};
+        std::atomic<uint64_t> total{0};
+        std::atomic<uint64_t> max{0};
+    };
+    Histogram histograms[HIST_COUNT];
+};
+
+struct HistogramSummary {
+    uint64_t count = 0;
+    uint64_t totalNanos = 0;
+    uint64_t p50 = 0;
+    uint64_t p99 = 0;
+    uint64_t p999 = 0;
+    uint64_t max = 0;
+};
+
+// Rejestr danych wątków. Każdy wątek dostaje swój blok przy pierwszym zapisie (jedyne miejsce
+// z blokadą); bloki żyją do końca procesu, bo wątki serwera też nie są kończone.
+class Metrics {
+public:
+    static Metrics& instance();
+    ThreadMetrics& local() {
+        thread_local ThreadMetrics* metrics = nullptr;
+        if (!metrics) metrics = registerThread();
+        return *metrics;
+    }
+    uint64_t counter(MetricCounter counter);
+    HistogramSummary summarize(MetricHistogram histogram);
+
+private:
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadMetrics>> threads;
+    ThreadMetrics* registerThread();
+};
+
+inline uint64_t metricsNow() {
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+inline void bumpLocal(std::atomic<uint64_t>& value, uint64_t amount) {
+    value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+inline void metricCount(MetricCounter counter, uint64_t amount = 1) {
+    bumpLocal(Metrics::instance().local().counters[counter], amount);
+}
+
+inline void metricRecord(MetricHistogram histogram, uint64_t nanos) {
+    ThreadMetrics::Histogram& h = Metrics::instance().local().histograms[histogram];
+    bumpLocal(h.buckets[histogramBucket(nanos)], 1);
+    bumpLocal(h.total, nanos);
+    if (nanos > h.max.load(std::memory_order_relaxed)) h.max.store(nanos, std::memory_order_relaxed);
+}
+
+// Mierzy czas od utworzenia do końca zakresu.
+class ScopedTimer {
+public:
+    explicit ScopedTimer(MetricHistogram histogram) : histogram(histogram), start(metricsNow()) {}
+    ~ScopedTimer() { metricRecord(histogram, metricsNow() - start); }
+private:
+    MetricHistogram histogram;
+    uint64_t start;
+};
+
+// Zamiennik std::lock_guard liczący zajęcia mutexu. Gdy try_lock się nie udaje, czas
+// oczekiwania trafia do histogramu; niezajęty mutex kosztuje tylko licznik, bez odczytu zegara.
+class MeasuredLock {
+public:
+    MeasuredLock(std::mutex& mutex, MetricHistogram waitHistogram, MetricCounter acquisitions)
+        : mutex(mutex) {
+        metricCount(acquisitions);
+        if (mutex.try_lock()) return;
+        uint64_t start = metricsNow();
+        mutex.lock();
+        metricRecord(waitHistogram, metricsNow() - start);
+    }
+    ~MeasuredLock() { mutex.unlock(); }
+    MeasuredLock(const MeasuredLock&) = delete;
+    MeasuredLock& operator=(const MeasuredLock&) = delete;
+private:
+    std::mutex& mutex;
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+
+// Ograniczona kolejka wielu producentów i wielu konsumentów bez blokad (algorytm D. Wjukowa).
+// Każda komórka ma licznik sekwencji: producent i konsument rezerwują pozycję jednym CAS
+// i nigdy nie czekają na siebie nawzajem. Pełna kolejka odrzuca push zamiast blokować.
+template <typename T>
+class MpmcQueue {
+public:
+    // capacity musi być potęgą dwójki.
+    explicit MpmcQueue(size_t capacity);
+    bool push(T&& value);
+    bool pop(T& value);
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) std::atomic<size_t> enqueuePos{0};
+    alignas(64) std::atomic<size_t> dequeuePos{0};
+};
+
+template <typename T>
+MpmcQueue<T>::MpmcQueue(size_t capacity) : cells(new Cell[capacity]), mask(capacity - 1) {
+    for (size_t i = 0; i < capacity; i++) cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+template <typename T>
+bool MpmcQueue<T>::push(T&& value) {
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+        cell = &cells[pos & mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = intptr_t(sequence) - intptr_t(pos);
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            return false;   // pełna
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    cell->value = std::move(value);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+bool MpmcQueue<T>::pop(T& value) {
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+        cell = &cells[pos & mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = intptr_t(sequence) - intptr_t(pos + 1);
+        if (diff == 0) {
+            if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            return false;   // pusta
+        } else {
+            pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+    value = std::move(cell->value);
+    cell->value = T();   // nie trzymamy zasobów (np. połączeń) w zwolnionej komórce
+    cell->sequence.store(pos + mask + 1, std::memory_order_release);
+    return true;
+}
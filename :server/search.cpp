@@ -0,0 +1,275 @@
+#include "search.h"
+
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+// Układ danych: wynik (16 bitów), głębokość (8), granica (2), indeks ruchu (8), generacja (6).
+void TranspositionTable::resize(size_t megabytes) {
+    size_t count = 1;
+    while (count * 2 * sizeof(Slot) <= megabytes * 1024 * 1024) count *= 2;
+    slots.reset(new Slot[count]());
+    mask = count - 1;
+}
+
+bool TranspositionTable::probe(uint64_t key, Entry& entry) const {
+    if (!slots) return false;
+    const Slot& slot = slots[key & mask];
+    uint64_t data = slot.data.load(std::memory_order_relaxed);
+    uint64_t check = slot.check.load(std::memory_order_relaxed);
+    if ((check ^ data) != key || data == 0) return false;
+    entry.score = int16_t(data & 0xFFFF);
+    entry.depth = int8_t((data >> 16) & 0xFF);
+    entry.bound = Bound((data >> 24) & 0x3);
+    int move = int((data >> 26) & 0xFF);
+    entry.moveIndex = move == NO_MOVE ? -1 : move;
+    return true;
+}
+
+void TranspositionTable::store(uint64_t key, int score, int depth, Bound bound, int moveIndex) {
+    if (!slots) return;
+    Slot& slot = slots[key & mask];
+    uint64_t gen = generation.load(std::memory_order_relaxed) & 0x3F;
+    uint64_t old = slot.data.load(std::memory_order_relaxed);
+    uint64_t oldKey = slot.check.load(std::memory_order_relaxed) ^ old;
+    // Głębszy wpis innej pozycji z bieżącego wyszukiwania jest cenniejszy od płytszego nowego.
+    if (old != 0 && oldKey != key && ((old >> 34) & 0x3F) == gen && int8_t((old >> 16) & 0xFF) > depth) return;
+    uint64_t data = uint64_t(uint16_t(int16_t(score))) |
+                    uint64_t(uint8_t(int8_t(std::min(depth, 127)))) << 16 |
+                    uint64_t(bound) << 24 |
+                    uint64_t(moveIndex < 0 ? NO_MOVE : moveIndex) << 26 |
+                    gen << 34;
+    slot.data.store(data, std::memory_order_relaxed);
+    slot.check.store(key ^ data, std::memory_order_relaxed);
+}
+
+SearchPool::~SearchPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    ready.notify_all();
+    for (auto& thread : threads) thread.join();
+}
+
+void SearchPool::start(int count) {
+    for (int i = 0; i < count; i++) threads.emplace_back(&SearchPool::loop, this);
+}
+
+void SearchPool::run(int helpers, const std::function<void(int)>& work) {
+    Batch batch{&work};
+    helpers = std::min(helpers, size());
+    if (helpers > 0) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (int i = 1; i <= helpers; i++) tasks.push_back({&batch, i});
+        }
+        ready.notify_all();
+    }
+    work(0);
+    if (helpers == 0) return;
+    std::unique_lock<std::mutex> lock(mutex);
+    tasks.erase(std::remove_if(tasks.begin(), tasks.end(), [&](const Task& task) { return task.batch == &batch; }),
+                tasks.end());
+    finished.wait(lock, [&] { return batch.running == 0; });
+}
+
+void SearchPool::loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        ready.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if (stopping) return;
+        Task task = tasks.front();
+        tasks.pop_front();
+        task.batch->running++;
+        lock.unlock();
+        (*task.batch->work)(task.slot);
+        lock.lock();
+        if (--task.batch->running == 0) finished.notify_all();
+    }
+}
+
+SearchEngine::SearchEngine(const Board& board, bool isWhite, int chainSquare, const SearchLimits& limits,
+                           TranspositionTable* tt)
+    : root(board), rootWhite(isWhite), rootChain(chainSquare), limits(limits), tt(tt) {
+    root.generateMoves(rootWhite, rootChain, rootMoves);
+}
+
+// Ocena z punktu widzenia strony na posunięciu: materiał, zaawansowanie pionków i obsadzona
+// linia przemiany przeciwnika.
+int SearchEngine::evaluate(const Board& board, bool isWhite) {
+    uint32_t whiteMen = board.white & ~board.kings;
+    uint32_t blackMen = board.black & ~board.kings;
+    int score = 100 * (__builtin_popcount(whiteMen) - __builtin_popcount(blackMen)) +
+                300 * (__builtin_popcount(board.white & board.kings) - __builtin_popcount(board.black & board.kings));
+    for (int row = 0; row < 8; row++) {
+        uint32_t rowMask = 0xFu << (row * 4);
+        // Białe idą w stronę wiersza 0, czarne w stronę wiersza 7.
+        score += 3 * (7 - row) * __builtin_popcount(whiteMen & rowMask) - 3 * row * __builtin_popcount(blackMen & rowMask);
+    }
+    score += 5 * (__builtin_popcount(whiteMen & BOTTOM_ROW) - __builtin_popcount(blackMen & TOP_ROW));
+    return isWhite ? score : -score;
+}
+
+bool SearchEngine::timeUp() {
+    return mayStop.load(std::memory_order_relaxed) && std::chrono::steady_clock::now() >= deadline;
+}
+
+// Wyniki matowe w tablicy są liczone od bieżącego węzła, a nie od korzenia.
+int SearchEngine::scoreToTT(int score, int ply) {
+    if (score >= MATE - MAX_PLY) return score + ply;
+    if (score <= -MATE + MAX_PLY) return score - ply;
+    return score;
+}
+
+int SearchEngine::scoreFromTT(int score, int ply) {
+    if (score >= MATE - MAX_PLY) return score - ply;
+    if (score <= -MATE + MAX_PLY) return score + ply;
+    return score;
+}
+
+// Ruch z tablicy transpozycji, bicia (najdłuższe najpierw), ruchy-zabójcy, potem historia.
+void SearchEngine::orderMoves(ThreadState& state, const MoveList& moves, int ply, int ttMove, int* scores) const {
+    for (int i = 0; i < moves.count; i++) {
+        const Move& move = moves.moves[i];
+        if (i == ttMove) scores[i] = 2000000;
+        else if (move.isCapture()) scores[i] = 1000000 + 1000 * __builtin_popcount(move.captured);
+        else if (sameMove(move, state.killers[ply][0])) scores[i] = 900000;
+        else if (sameMove(move, state.killers[ply][1])) scores[i] = 800000;
+        else scores[i] = state.history[move.from][move.to()];
+    }
+}
+
+// Jedna plansza na wątek, modyfikowana przez applyMove/undoMove w trakcie całego przeszukiwania.
+int SearchEngine::negamax(ThreadState& state, Board& board, bool isWhite, int depth, int ply, int alpha, int beta) {
+    if ((++state.nodes & 1023) == 0 && timeUp()) stopped.store(true, std::memory_order_relaxed);
+    if (stopped.load(std::memory_order_relaxed)) return 0;
+    if (ply >= MAX_PLY) return evaluate(board, isWhite);
+    // Za horyzontem liczymy dalej tylko wymuszone bicia, aby nie oceniać pozycji w połowie wymiany.
+    if (depth <= 0 && !board.capturingPieces(isWhite)) return evaluate(board, isWhite);
+
+    int alphaOriginal = alpha;
+    int ttMove = -1;
+    uint64_t key = board.hash ^ (isWhite ? 0 : ZOBRIST.blackToMove);
+    TranspositionTable::Entry entry;
+    if (tt && depth > 0 && tt->probe(key, entry)) {
+        ttMove = entry.moveIndex;
+        if (entry.depth >= depth) {
+            int score = scoreFromTT(entry.score, ply);
+            if (entry.bound == TranspositionTable::BOUND_EXACT) return score;
+            if (entry.bound == TranspositionTable::BOUND_LOWER && score >= beta) return score;
+            if (entry.bound == TranspositionTable::BOUND_UPPER && score <= alpha) return score;
+        }
+    }
+
+    MoveList moves;
+    board.generateMoves(isWhite, -1, moves);
+    if (moves.count == 0) return -MATE + ply;
+    int scores[MAX_MOVES];
+    orderMoves(state, moves, ply, ttMove, scores);
+    // Sortujemy indeksy, aby zachować pozycje ruchów z generatora zapisywane w tablicy.
+    uint8_t order[MAX_MOVES];
+    for (int i = 0; i < moves.count; i++) order[i] = uint8_t(i);
+
+    int best = -INF;
+    int bestMove = -1;
+    for (int i = 0; i < moves.count; i++) {
+        // Sortowanie przez wybieranie: zwykle odcięcie następuje po kilku pierwszych ruchach.
+        int pick = i;
+        for (int j = i + 1; j < moves.count; j++) {
+            if (scores[order[j]] > scores[order[pick]]) pick = j;
+        }
+        std::swap(order[i], order[pick]);
+        const Move& move = moves.moves[order[i]];
+
+        UndoRecord undo;
+        board.applyMove(move, isWhite, undo);
+        int score = -negamax(state, board, !isWhite, depth - 1, ply + 1, -beta, -alpha);
+        board.undoMove(move, isWhite, undo);
+        if (stopped.load(std::memory_order_relaxed)) return 0;
+        if (score > best) {
+            best = score;
+            bestMove = order[i];
+        }
+        if (score > alpha) alpha = score;
+        if (alpha >= beta) {
+            if (!move.isCapture()) {
+                if (!sameMove(move, state.killers[ply][0])) {
+                    state.killers[ply][1] = state.killers[ply][0];
+                    state.killers[ply][0] = move;
+                }
+                state.history[move.from][move.to()] += depth * depth;
+            }
+            break;
+        }
+    }
+    if (tt && depth > 0) {
+        TranspositionTable::Bound bound = best <= alphaOriginal ? TranspositionTable::BOUND_UPPER
+                                        : best >= beta ? TranspositionTable::BOUND_LOWER
+                                        : TranspositionTable::BOUND_EXACT;
+        tt->store(key, scoreToTT(best, ply), depth, bound, bestMove);
+    }
+    return best;
+}
+
+void SearchEngine::searchRoot(ThreadState& state, int depth) {
+    Board board = root;
+    while (true) {
+        int i = nextRootMove.fetch_add(1);
+        if (i >= rootMoves.count) return;
+        UndoRecord undo;
+        board.applyMove(rootMoves.moves[i], rootWhite, undo);
+        int alpha = bestScore.load();
+        int score = -negamax(state, board, !rootWhite, depth - 1, 1, -INF, -alpha);
+        board.undoMove(rootMoves.moves[i], rootWhite, undo);
+        if (stopped.load(std::memory_order_relaxed)) return;
+        rootScores[i] = score;
+        std::lock_guard<std::mutex> lock(bestMutex);
+        if (score > bestScore.load()) {
+            bestScore.store(score);
+            bestIndex = i;
+        }
+    }
+}
+
+SearchResult SearchEngine::run() {
+    SearchResult result;
+    if (rootMoves.count == 0) return result;
+    result.move = rootMoves.moves[0];
+    result.found = true;
+    if (rootMoves.count == 1) return result;
+
+    auto start = std::chrono::steady_clock::now();
+    deadline = start + std::chrono::milliseconds(limits.timeMs);
+    if (tt) tt->newSearch();
+    int helpers = limits.pool ? std::min(std::max(0, limits.threads - 1), limits.pool->size()) : 0;
+    std::vector<ThreadState> states(helpers + 1);
+    for (int depth = 1; depth <= limits.maxDepth; depth++) {
+        nextRootMove = 0;
+        bestScore = -INF;
+        bestIndex = -1;
+        if (helpers > 0) {
+            limits.pool->run(helpers, [&](int slot) { searchRoot(states[slot], depth); });
+        } else {
+            searchRoot(states[0], depth);
+        }
+        if (stopped.load()) break;
+
+        result.move = rootMoves.moves[bestIndex];
+        result.score = bestScore.load();
+        result.depth = depth;
+        mayStop.store(true);
+        // Kolejna iteracja zaczyna od najlepszych ruchów poprzedniej.
+        for (int i = 1; i < rootMoves.count; i++) {
+            for (int j = i; j > 0 && rootScores[j] > rootScores[j - 1]; j--) {
+                std::swap(rootScores[j], rootScores[j - 1]);
+                std::swap(rootMoves.moves[j], rootMoves.moves[j - 1]);
+            }
+        }
+        if (abs(result.score) >= MATE - MAX_PLY) break;
+        // Następna iteracja trwa zwykle kilka razy dłużej, więc po połowie budżetu jej nie zaczynamy.
+        if (std::chrono::steady_clock::now() - start > std::chrono::milliseconds(limits.timeMs / 2)) break;
+    }
+    for (const auto& state : states) result.nodes += state.nodes;
+    return result;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "board.h"
+
+// Tablica transpozycji o stałym rozmiarze, współdzielona przez wszystkie wątki i wyszukiwania.
+// Działa bez blokad: wpis to dwa słowa 64-bitowe, a klucz zapisany jest jako XOR z danymi,
+// więc wpis rozdarty przez równoległy zapis innego wątku daje po prostu chybienie.
+class TranspositionTable {
+public:
+    enum Bound : uint8_t {
+        BOUND_NONE = 0,
+        BOUND_UPPER = 1,
+        BOUND_LOWER = 2,
+        BOUND_EXACT = 3
+    };
+    struct Entry {
+        int score;
+        int depth;
+        Bound bound;
+        int moveIndex;   // indeks najlepszego ruchu w liście z generateMoves (-1: brak)
+    };
+    static const int NO_MOVE = 0xFF;
+
+    void resize(size_t megabytes);
+    size_t size() const { return mask + 1; }
+    void newSearch() { generation.fetch_add(1, std::memory_order_relaxed); }
+    bool probe(uint64_t key, Entry& entry) const;
+    void store(uint64_t key, int score, int depth, Bound bound, int moveIndex);
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+    std::unique_ptr<Slot[]> slots;
+    size_t mask = 0;
+    std::atomic<uint32_t> generation{0};
+};
+
+// Stała pula wątków pomocniczych przeszukiwania, tworzona raz i wspólna dla wszystkich
+// wyszukiwań; iteracje nie tworzą własnych wątków, więc liczba zajętych rdzeni jest ograniczona
+// rozmiarem puli niezależnie od liczby gier z komputerem.
+class SearchPool {
+public:
+    ~SearchPool();
+    void start(int threads);
+    int size() const { return int(threads.size()); }
+    // Wykonuje work(0) w wątku wołającym i work(1..helpers) w wątkach puli; wraca, gdy wszystkie
+    // rozpoczęte skończą. Zadania, których pula nie zdążyła zacząć przed końcem work(0), są
+    // pomijane: praca jest dzielona przez licznik, więc nie zostało już nic do zrobienia.
+    void run(int helpers, const std::function<void(int)>& work);
+
+private:
+    struct Batch {
+        const std::function<void(int)>* work;
+        int running = 0;
+    };
+    struct Task {
+        Batch* batch;
+        int slot;
+    };
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::condition_variable finished;
+    std::deque<Task> tasks;
+    std::vector<std::thread> threads;
+    bool stopping = false;
+    void loop();
+};
+
+// Silnik komputerowego przeciwnika: negamax z cięciami alfa-beta i iteracyjnym pogłębianiem.
+// Ruchy pochodzą z tego samego generatora co walidacja ruchów graczy (Board::generateMoves),
+// więc silnik gra dokładnie według zasad akceptowanych przez serwer. Wątki dzielą między
+// siebie ruchy korzenia, a najlepszy znany wynik zawęża okno pozostałych ruchów; pozostałą
+// wiedzę wymieniają przez wspólną tablicę transpozycji.
+struct SearchLimits {
+    int maxDepth = 64;
+    int timeMs = 1000;
+    int threads = 1;             // razem z wątkiem wołającym; dodatkowe pochodzą z pool
+    SearchPool* pool = nullptr;  // bez puli wyszukiwanie jest jednowątkowe
+};
+
+struct SearchResult {
+    Move move;
+    int score = 0;
+    int depth = 0;
+    uint64_t nodes = 0;
+    bool found = false;
+};
+
+class SearchEngine {
+public:
+    static const int MATE = 30000;
+    static const int INF = 32000;
+    static const int MAX_PLY = 64;
+
+    SearchEngine(const Board& board, bool isWhite, int chainSquare, const SearchLimits& limits,
+                 TranspositionTable* tt = nullptr);
+    SearchResult run();
+    static int evaluate(const Board& board, bool isWhite);
+
+private:
+    // Heurystyki porządkowania ruchów są prywatne dla wątku, więc nie wymagają synchronizacji.
+    struct ThreadState {
+        Move killers[MAX_PLY][2];
+        int history[32][32] = {};
+        uint64_t nodes = 0;
+    };
+
+    Board root;
+    bool rootWhite;
+    int rootChain;
+    SearchLimits limits;
+    TranspositionTable* tt;
+    MoveList rootMoves;
+    std::chrono::steady_clock::time_point deadline;
+    std::atomic<bool> stopped{false};
+    std::atomic<bool> mayStop{false};   // pierwsza iteracja zawsze kończy się, aby był jakiś ruch
+
+    // Stan bieżącej iteracji korzenia.
+    std::atomic<int> nextRootMove{0};
+    std::atomic<int> bestScore{-INF};
+    std::mutex bestMutex;
+    int bestIndex = -1;
+    int rootScores[MAX_MOVES];
+
+    void searchRoot(ThreadState& state, int depth);
+    int negamax(ThreadState& state, Board& board, bool isWhite, int depth, int ply, int alpha, int beta);
+    void orderMoves(ThreadState& state, const MoveList& moves, int ply, int ttMove, int* scores) const;
+    static int scoreToTT(int score, int ply);
+    static int scoreFromTT(int score, int ply);
+    bool timeUp();
+};
+
+inline bool sameMove(const Move& a, const Move& b) {
+    if (a.from != b.from || a.hops != b.hops || a.captured != b.captured) return false;
+    for (int i = 0; i < a.hops; i++) {
+        if (a.path[i] != b.path[i]) return false;
+    }
+    return true;
+}
+
+// Poziomy komputera: maksymalna głębokość i budżet czasu na ruch.
+struct BotLevel {
+    int maxDepth;
+    int timeMs;
+};
+const BotLevel BOT_LEVELS[] = {{2, 50}, {4, 150}, {6, 400}, {12, 1000}, {SearchEngine::MAX_PLY, 2500}};
+const int BOT_LEVEL_COUNT = sizeof(BOT_LEVELS) / sizeof(BOT_LEVELS[0]);
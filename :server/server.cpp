@@ -1,505 +1,1335 @@
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/uio.h>
+#include <signal.h>
 #include <netinet/in.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdarg.h>
 #include <thread>
 #include <vector>
 #include <map>
 #include <mutex>
-#include <iostream>
-#include <sstream>
 #include <set>
+#include <unordered_set>
+#include <cmath>
 #include <queue>
 #include <chrono>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+#include <string_view>
+#include <charconv>
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <condition_variable>
+#include <random>
 
-class Game {
+#include "logger.h"
+#include "board.h"
+#include "game.h"
+#include "search.h"
+#include "metrics.h"
+#include "journal.h"
+#include "endgame.h"
+#include "book.h"
+#include "mpmc_queue.h"
+#include "timing_wheel.h"
+
+struct EventLoop;
+
+// Najdłuższa akceptowana linia komendy; dłuższa bez '\n' oznacza zepsutego klienta.
+const size_t MAX_COMMAND_LENGTH = 4096;
+
+// Zwraca kolejny token oddzielony białymi znakami i przesuwa widok za niego (bez kopiowania).
+inline std::string_view nextToken(std::string_view& rest) {
+    size_t start = rest.find_first_not_of(" \t\r\n");
+    if (start == std::string_view::npos) {
+        rest = std::string_view();
+        return rest;
+    }
+    rest.remove_prefix(start);
+    size_t end = std::min(rest.find_first_of(" \t\r\n"), rest.size());
+    std::string_view token = rest.substr(0, end);
+    rest.remove_prefix(end);
+    return token;
+}
+
+inline bool parseInt(std::string_view token, int& value) {
+    auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+    return result.ec == std::errc() && result.ptr == token.data() + token.size();
+}
+
+struct Connection;
+
+// Rodzaje timerów serwera; wszystkie obsługuje jedno koło czasowe w jednym wątku.
+enum TimerKind : uint8_t {
+    TIMER_CLOCK,   // zegar gracza na posunięciu
+    TIMER_GRACE,   // okres karencji rozłączonego gracza (index to jego kolor)
+    TIMER_IDLE     // bezczynne połączenie
+};
+
+// Timer osadzony w sesji gry albo w połączeniu. Generacja rośnie przy każdym przestawieniu
+// i anulowaniu, więc wygaśnięcie zebrane przed taką zmianą da się rozpoznać jako nieaktualne.
+struct ServerTimer : TimerNode {
+    TimerKind kind = TIMER_CLOCK;
+    int index = 0;
+    uint64_t handle = 0;          // GameHandle sesji (TIMER_CLOCK, TIMER_GRACE)
+    Connection* conn = nullptr;   // TIMER_IDLE
+    uint64_t generation = 0;
+};
+
+// Wygasły timer skopiowany pod blokadą koła; nie zależy już od czasu życia właściciela.
+struct ExpiredTimer {
+    TimerKind kind;
+    int index;
+    uint64_t handle;
+    uint64_t generation;
+    std::shared_ptr<Connection> conn;
+};
+
+const std::chrono::milliseconds TIMER_TICK(10);
+
+// Zegary gier, okresy karencji i limity bezczynności połączeń w jednym hierarchicznym kole.
+// Wstawienie i anulowanie to O(1) pod krótką blokadą, a wątek timerów budzi się raz na tik
+// niezależnie od liczby timerów. Właściciel timera anuluje go w destruktorze.
+class TimerService {
 public:
-    // Udostępnione wartości, aby można było je używać poza klasą.
-    enum Piece {
-        BOARD_SIZE = 8,
-        EMPTY = 0,
-        WHITE_PIECE = 1,
-        BLACK_PIECE = 2,
-        WHITE_KING = 3,
-        BLACK_KING = 4
-    };
+    void schedule(ServerTimer& timer, std::chrono::steady_clock::time_point when);
+    void cancel(ServerTimer& timer);
+    bool isCurrent(const ServerTimer& timer, uint64_t generation);
+    // Przesuwa koło do chwili now i dopisuje wygasłe timery do out.
+    void collect(std::chrono::steady_clock::time_point now, std::vector<ExpiredTimer>& out);
+    size_t size();
 
 private:
-    std::string gameId;
-    int whiteCount = 12;
-    int blackCount = 12;
-    std::vector<std::vector<int>> board;
-    int currentPlayer;
-    std::string player1, player2;
+    std::mutex mutex;
+    TimingWheel wheel;
+    std::chrono::steady_clock::time_point base = std::chrono::steady_clock::now();
+    std::vector<TimerNode*> expired;
+};
 
-    void initializeBoard();
+inline int64_t steadyMillis(std::chrono::steady_clock::time_point when) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(when.time_since_epoch()).count();
+}
 
-public:
-    Game(const std::string& p1, const std::string& p2);
-    bool checkGameEnd();
-    void setCurrentPlayer(int player);
-    void printBoard();
-    std::string getBoardState() const;
-    std::vector<std::pair<int, int>> getAvailableCaptures(int x, int y, bool isWhite);
-    std::vector<std::pair<int, int>> getAllAvailableCaptures(bool isWhite);
-    bool isValidMove(int fromX, int fromY, int toX, int toY, bool isWhite);
-    void makeMove(int fromX, int fromY, int toX, int toY, const std::string& playerName);
-    int getCurrentPlayer() const;
-    std::string getOpponent(const std::string& player);
-    std::string getPlayer1() const;
-    bool isKingAt(int x, int y);
-    std::pair<int, int> getCapturedCoordinatesForKing(int fromX, int fromY, int toX, int toY);
-    int getPieceAt(int x, int y);
-    int getWhiteCount() const { return whiteCount; };
-    int getBlackCount() const { return blackCount; };
+// Stan pojedynczego połączenia: nieblokujące gniazdo oraz bufory odczytu i zapisu.
+struct Connection : std::enable_shared_from_this<Connection> {
+    int fd = -1;
+    EventLoop* loop = nullptr;
+    // Nazwa gracza: ustawiana raz (pierwszy CONNECT albo RESUME) przez wątek pętli połączenia
+    // i potem niezmienna. Inne wątki (timery, kojarzenie, komputer) czytają ją przez displayName.
+    std::string playerName;
+    std::atomic<bool> named{false};
+    PlayerId playerId = NO_PLAYER;
+    std::atomic<uint64_t> game{0};  // GameHandle bieżącej gry; ustawiany przez wątek tworzący grę
+    std::string inBuffer;    // odebrane bajty, w tym niedokończona ostatnia linia
+    // Po "CONNECT <nick> BINARY" ramki binarne w obu kierunkach; ustalane przy pierwszym CONNECT
+    // (albo RESUME) i czytane także przez wątki wysyłające komunikaty.
+    std::atomic<bool> binary{false};
+    std::atomic<uint64_t> watching{0};  // GameHandle obserwowanej gry (WATCH); 0 = brak
+    std::atomic<uint64_t> watchEpoch{0};// zmieniany przy każdym WATCH i jego końcu
 
+    void setName(std::string_view name) {
+        playerName.assign(name);
+        named.store(true, std::memory_order_release);
+    }
+    const char* displayName() const { return named.load(std::memory_order_acquire) ? playerName.c_str() : ""; }
+    // Kolejka wychodząca: współdzielone, niezmienne bufory komunikatów. Wszystko, co powstało
+    // podczas obsługi jednej partii zdarzeń, trafia do gniazda jednym writev.
+    std::mutex writeMutex;
+    std::vector<std::shared_ptr<const std::string>> outQueue;
+    size_t outHead = 0;          // pierwszy niewysłany komunikat
+    size_t outOffset = 0;        // bajty już wysłane z outQueue[outHead]
+    size_t queuedBytes = 0;
+    uint32_t epollEvents = EPOLLIN | EPOLLRDHUP;
+    bool flushScheduled = false; // połączenie czeka na liście do zapisu któregoś wątku
+    bool closed = false;
+    // Chwila ostatniego odczytu (steadyMillis); timer bezczynności sprawdza ją dopiero przy
+    // wygaśnięciu, więc odczyt nie przestawia timera.
+    std::atomic<int64_t> lastActivityMs{0};
+    TimerService* timers = nullptr;
+    ServerTimer idleTimer;
+
+    ~Connection() { if (timers) timers->cancel(idleTimer); }
 };
 
-Game::Game(const std::string& p1, const std::string& p2)
-    : gameId(p1 + "_vs_" + p2),
-      board(BOARD_SIZE, std::vector<int>(BOARD_SIZE, EMPTY)),
-      player1(p1), player2(p2), currentPlayer(1) {
-    initializeBoard();
+// Zaokrąglenie w górę przy wstawianiu i w dół przy przesuwaniu: timer nie wygasa przed terminem.
+void TimerService::schedule(ServerTimer& timer, std::chrono::steady_clock::time_point when) {
+    int64_t ticks = when <= base ? 0 : (when - base + TIMER_TICK - std::chrono::nanoseconds(1)) / TIMER_TICK;
+    std::lock_guard<std::mutex> lock(mutex);
+    timer.generation++;
+    wheel.schedule(&timer, uint64_t(ticks));
 }
 
-void Game::initializeBoard() {
-    for (int row = 0; row < 3; row++) {
-        for (int col = 0; col < BOARD_SIZE; col++) {
-            if ((row + col) % 2 == 1) {
-                board[row][col] = BLACK_PIECE;
-            }
+void TimerService::cancel(ServerTimer& timer) {
+    std::lock_guard<std::mutex> lock(mutex);
+    timer.generation++;
+    wheel.cancel(&timer);
+}
+
+bool TimerService::isCurrent(const ServerTimer& timer, uint64_t generation) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return timer.generation == generation;
+}
+
+// Połączenie w trakcie niszczenia czeka w destruktorze na tę blokadę, więc wskaźnik conn
+// jest tu ważny, a weak_from_this() zwróci pusty wskaźnik.
+void TimerService::collect(std::chrono::steady_clock::time_point now, std::vector<ExpiredTimer>& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    wheel.advance(uint64_t((now - base) / TIMER_TICK), expired);
+    for (TimerNode* node : expired) {
+        ServerTimer* timer = static_cast<ServerTimer*>(node);
+        out.push_back({timer->kind, timer->index, timer->handle, timer->generation,
+                       timer->conn ? timer->conn->weak_from_this().lock() : nullptr});
+    }
+    expired.clear();
+}
+
+size_t TimerService::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return wheel.size();
+}
+
+// Powyżej tego progu wstrzymujemy czytanie komend od klienta, który nie odbiera odpowiedzi;
+// powyżej limitu połączenie jest zamykane zamiast buforować bez końca.
+const size_t OUTBOUND_PAUSE_BYTES = 64 * 1024;
+const size_t MAX_OUTBOUND_BYTES = 1024 * 1024;
+// Obserwator, który nie nadąża, może zalegać tylko tyle; potem jest rozłączany, a gracze
+// i pozostali obserwatorzy nie czekają na niego.
+const size_t WATCHER_MAX_OUTBOUND_BYTES = 256 * 1024;
+
+// Tryb binarny wybierany przez "CONNECT <nick> BINARY\n". Każda ramka ma stały 2-bajtowy
+// nagłówek: typ i długość danych (0-255). Pola to indeksy 0-31 (x * 4 + y / 2).
+enum BinaryType : uint8_t {
+    // klient -> serwer
+    BIN_MOVE = 0x01,              // [skąd, dokąd]
+    BIN_BOARD_REQUEST = 0x02,
+    BIN_PLAY_BOT = 0x03,          // [poziom]
+    BIN_WATCH = 0x04,             // [identyfikator gry, 8 bajtów little-endian]
+    // serwer -> klient
+    BIN_COLOR = 0x10,             // [0 biały, 1 czarny]
+    BIN_GAME_START = 0x11,
+    BIN_YOUR_TURN = 0x12,
+    BIN_WAIT_TURN = 0x13,
+    BIN_MOVE_UPDATE = 0x14,       // [skąd, dokąd, zbite pole lub 0xFF, flagi: bit 0 = damka]
+    BIN_NOT_YOUR_TURN = 0x15,
+    BIN_INVALID_MOVE = 0x16,
+    BIN_NO_GAME_FOUND = 0x17,
+    BIN_OPPONENT_DISCONNECTED = 0x18,
+    BIN_GAME_OVER = 0x19,         // [0 biały, 1 czarny, 2 brak zwycięzcy]
+    BIN_BOARD = 0x1A,             // [16 bajtów z Game::getPackedBoard]
+    BIN_GAME_ID = 0x1B,           // [identyfikator gry dla WATCH, 8 bajtów little-endian]
+    BIN_SESSION = 0x1C,           // [identyfikator gry, 8 bajtów; sekret RESUME, 8 bajtów; little-endian]
+    BIN_RESUMED = 0x1D,           // [0 biały, 1 czarny; numer pierwszego dosyłanego skoku, 4 bajty little-endian]
+    BIN_OPPONENT_AWAY = 0x1E,
+    BIN_OPPONENT_BACK = 0x1F,
+    BIN_SERVER_BUSY = 0x20,       // kolejka kojarzenia pełna, CONNECT trzeba powtórzyć
+    BIN_CLOCK = 0x21              // [czas białego, czas czarnego; ms, po 4 bajty little-endian]
+};
+
+const size_t BINARY_HEADER_SIZE = 2;
+const uint8_t NO_SQUARE = 0xFF;
+
+// Komunikat w obu kodowaniach; połączenie dostaje bufor swojego protokołu.
+struct OutMessage {
+    std::shared_ptr<const std::string> text;
+    std::shared_ptr<const std::string> binary;
+};
+
+OutMessage makeMessage(const std::string& text, uint8_t type, const uint8_t* payload = nullptr, uint8_t length = 0) {
+    std::string frame(BINARY_HEADER_SIZE + length, '\0');
+    frame[0] = char(type);
+    frame[1] = char(length);
+    for (int i = 0; i < length; i++) frame[BINARY_HEADER_SIZE + i] = char(payload[i]);
+    return {std::make_shared<const std::string>(text + "\n"), std::make_shared<const std::string>(std::move(frame))};
+}
+
+// Komunikaty bez parametrów budujemy raz i współdzielimy między wszystkimi połączeniami.
+const uint8_t COLOR_WHITE = 0, COLOR_BLACK = 1;
+const OutMessage MSG_COLOR_WHITE = makeMessage("COLOR white", BIN_COLOR, &COLOR_WHITE, 1);
+const OutMessage MSG_COLOR_BLACK = makeMessage("COLOR black", BIN_COLOR, &COLOR_BLACK, 1);
+const OutMessage MSG_GAME_START = makeMessage("GAME_START", BIN_GAME_START);
+const OutMessage MSG_YOUR_TURN = makeMessage("YOUR_TURN", BIN_YOUR_TURN);
+const OutMessage MSG_WAIT_TURN = makeMessage("WAIT_TURN", BIN_WAIT_TURN);
+const OutMessage MSG_NOT_YOUR_TURN = makeMessage("NOT_YOUR_TURN", BIN_NOT_YOUR_TURN);
+const OutMessage MSG_INVALID_MOVE = makeMessage("INVALID_MOVE", BIN_INVALID_MOVE);
+const OutMessage MSG_NO_GAME_FOUND = makeMessage("NO_GAME_FOUND", BIN_NO_GAME_FOUND);
+const OutMessage MSG_OPPONENT_DISCONNECTED = makeMessage("OPPONENT_DISCONNECTED", BIN_OPPONENT_DISCONNECTED);
+const OutMessage MSG_OPPONENT_AWAY = makeMessage("OPPONENT_AWAY", BIN_OPPONENT_AWAY);
+const OutMessage MSG_OPPONENT_BACK = makeMessage("OPPONENT_BACK", BIN_OPPONENT_BACK);
+const OutMessage MSG_SERVER_BUSY = makeMessage("SERVER_BUSY", BIN_SERVER_BUSY);
+
+OutMessage makeMoveUpdate(int fromX, int fromY, int toX, int toY, int capturedSq, bool king) {
+    std::string text = "MOVE_UPDATE " + std::to_string(fromX) + " " + std::to_string(fromY) + " " +
+                       std::to_string(toX) + " " + std::to_string(toY);
+    if (capturedSq >= 0) {
+        text += " CAPTURE " + std::to_string(squareRow(capturedSq)) + " " + std::to_string(squareCol(capturedSq));
+    }
+    if (king) {
+        text += " KING";
+    }
+    uint8_t payload[4] = {uint8_t(squareIndex(fromX, fromY)), uint8_t(squareIndex(toX, toY)),
+                          capturedSq >= 0 ? uint8_t(capturedSq) : NO_SQUARE, uint8_t(king ? 1 : 0)};
+    return makeMessage(text, BIN_MOVE_UPDATE, payload, 4);
+}
+
+// Przegrana na czas: "GAME_OVER <zwycięzca> TIME", w ramce binarnej drugi bajt równy 1.
+OutMessage makeGameOver(const std::string& winner, bool onTime = false) {
+    uint8_t payload[2] = {uint8_t(winner == "white" ? 0 : winner == "black" ? 1 : 2), 1};
+    return makeMessage("GAME_OVER " + winner + (onTime ? " TIME" : ""), BIN_GAME_OVER, payload, onTime ? 2 : 1);
+}
+
+// "CLOCK <biały> <czarny>": pozostały czas obu graczy w ms; biegnie zegar strony na posunięciu.
+OutMessage makeClockMessage(int64_t whiteMs, int64_t blackMs) {
+    uint32_t times[2] = {uint32_t(std::max<int64_t>(whiteMs, 0)), uint32_t(std::max<int64_t>(blackMs, 0))};
+    uint8_t payload[8];
+    for (int i = 0; i < 4; i++) {
+        payload[i] = uint8_t(times[0] >> (8 * i));
+        payload[4 + i] = uint8_t(times[1] >> (8 * i));
+    }
+    return makeMessage("CLOCK " + std::to_string(times[0]) + " " + std::to_string(times[1]), BIN_CLOCK, payload, 8);
+}
+
+OutMessage makeGameIdMessage(uint64_t gameId) {
+    uint8_t payload[8];
+    for (int i = 0; i < 8; i++) payload[i] = uint8_t(gameId >> (8 * i));
+    return makeMessage("GAME_ID " + std::to_string(gameId), BIN_GAME_ID, payload, 8);
+}
+
+// Token wznowienia: "SESSION <gra> <sekret>". Klient, któremu zerwało się połączenie, wysyła
+// na nowym "RESUME <gra> <sekret> <liczba otrzymanych MOVE_UPDATE>".
+OutMessage makeSessionMessage(uint64_t gameId, uint64_t secret) {
+    uint8_t payload[16];
+    for (int i = 0; i < 8; i++) {
+        payload[i] = uint8_t(gameId >> (8 * i));
+        payload[8 + i] = uint8_t(secret >> (8 * i));
+    }
+    return makeMessage("SESSION " + std::to_string(gameId) + " " + std::to_string(secret), BIN_SESSION, payload, 16);
+}
+
+// "RESUMED <kolor> <n>": kolejne MOVE_UPDATE to skoki od numeru n (albo BOARD ze stanem po
+// wszystkich skokach, gdy n to ich liczba), a po nich YOUR_TURN, WAIT_TURN lub GAME_OVER.
+OutMessage makeResumedMessage(int color, uint32_t firstHop) {
+    uint8_t payload[5] = {uint8_t(color), uint8_t(firstHop), uint8_t(firstHop >> 8), uint8_t(firstHop >> 16),
+                          uint8_t(firstHop >> 24)};
+    return makeMessage(std::string("RESUMED ") + (color == 0 ? "white " : "black ") + std::to_string(firstHop),
+                       BIN_RESUMED, payload, 5);
+}
+
+// Wynik zakończonej gry w postaci używanej przez GAME_OVER.
+std::string gameResult(const Game& game) {
+    if (game.isDraw()) return "draw";
+    if (game.getWhiteCount() == 0) return "black";
+    if (game.getBlackCount() == 0) return "white";
+    return "";
+}
+
+OutMessage makeBoardMessage(const Game& game) {
+    uint8_t packed[16];
+    game.getPackedBoard(packed);
+    return makeMessage("BOARD " + game.getBoardState(), BIN_BOARD, packed, 16);
+}
+
+// Sekret RESUME: losowy i niezerowy, z generatora danego wątku.
+uint64_t newSessionSecret() {
+    thread_local std::mt19937_64 rng(std::random_device{}());
+    uint64_t secret;
+    do secret = rng(); while (secret == 0);
+    return secret;
+}
+
+// Pętla zdarzeń jednego wątku roboczego: własny deskryptor epoll i obsługiwane połączenia.
+struct EventLoop {
+    int epollFd = -1;
+    std::thread thread;
+    std::mutex connectionsMutex;
+    std::unordered_map<int, std::shared_ptr<Connection>> connections;
+};
+
+// Pula obiektów Game przydzielanych blokami o stałym rozmiarze. Zwolnione gry trafiają na listę
+// wolnych i są ponownie używane po resecie do pozycji startowej, więc przy dużej rotacji gier
+// sterta nie jest fragmentowana. Bloki nie są zwalniane, a adresy gier pozostają stałe.
+class GamePool {
+public:
+    static const size_t BLOCK_SIZE = 256;
+    Game* acquire(PlayerId player1, PlayerId player2);
+    void release(Game* game);
+    size_t inUse();
+    size_t capacity();
+private:
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Game[]>> blocks;
+    std::vector<Game*> freeList;
+    size_t used = 0;
+};
+
+Game* GamePool::acquire(PlayerId player1, PlayerId player2) {
+    Game* game;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (freeList.empty()) {
+            blocks.emplace_back(new Game[BLOCK_SIZE]);
+            Game* block = blocks.back().get();
+            for (size_t i = BLOCK_SIZE; i-- > 0;) freeList.push_back(&block[i]);
+            LOG_INFO("Pula gier powiększona do %zu (zajęte %zu)", blocks.size() * BLOCK_SIZE, used);
         }
+        game = freeList.back();
+        freeList.pop_back();
+        used++;
     }
-    for (int row = 5; row < BOARD_SIZE; row++) {
-        for (int col = 0; col < BOARD_SIZE; col++) {
-            if ((row + col) % 2 == 1) {
-                board[row][col] = WHITE_PIECE;
-            }
+    game->reset(player1, player2);
+    return game;
+}
+
+void GamePool::release(Game* game) {
+    std::lock_guard<std::mutex> lock(mutex);
+    freeList.push_back(game);
+    used--;
+}
+
+size_t GamePool::inUse() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return used;
+}
+
+size_t GamePool::capacity() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return blocks.size() * BLOCK_SIZE;
+}
+
+// Uchwyt gry: indeks slotu w młodszych 32 bitach, generacja w starszych. Generacje zaczynają
+// się od 1, więc 0 nigdy nie wskazuje gry.
+using GameHandle = uint64_t;
+const GameHandle NO_GAME = 0;
+// Połączenie zajęte przez tworzenie gry (kojarzenie lub PLAY_BOT); nie wskazuje żadnego slotu.
+const GameHandle PAIRING_GAME = ~GameHandle(0);
+// Tożsamość komputera w grach z PLAY_BOT. internPlayer nadaje kolejne numery od zera, więc nie
+// zwróci jej żaden gracz, także taki, który połączy się pod nazwą "komputer poziom N".
+const PlayerId BOT_PLAYER = NO_PLAYER - 1;
+
+// Opublikowana lista obserwatorów gry jest niezmienna, więc rozesłanie ruchu zabiera tylko
+// wskaźnik i nie trzyma blokady sesji. Wpis jest ważny, dopóki watchEpoch połączenia nie
+// zmieni się od WATCH; odejście obserwatora tylko unieważnia wpis, bez kopiowania listy.
+struct Watcher {
+    std::shared_ptr<Connection> conn;
+    uint64_t epoch;
+
+    bool active() const { return conn->watchEpoch.load(std::memory_order_relaxed) == epoch; }
+};
+using WatcherList = std::vector<Watcher>;
+
+// Wykonany skok w zapisie historii gry; z niego odtwarzany jest MOVE_UPDATE przy RESUME.
+struct HopRecord {
+    uint8_t from;
+    uint8_t to;
+    int8_t captured;     // zbite pole lub -1
+    bool king;           // na polu docelowym stoi damka
+};
+
+// Zaległość dłuższa niż tyle skoków jest wysyłana jako migawka planszy (BOARD).
+const uint32_t MAX_RESUME_DELTA = 32;
+
+// Pojedyncza rozgrywka z własną blokadą: ruchy w różnych grach nie konkurują o wspólny mutex.
+// Indeks 0 to gracz biały, 1 to czarny.
+struct GameSession {
+    GameHandle handle = NO_GAME;
+    std::mutex mutex;
+    GamePool* pool = nullptr;
+    Game* game = nullptr;    // obiekt z puli, zwracany w destruktorze
+    PlayerId players[2] = {NO_PLAYER, NO_PLAYER};
+    std::shared_ptr<Connection> connections[2];
+    int botLevel = 0;        // > 0: czarnymi gra komputer na tym poziomie
+    bool finished = false;   // gra usunięta z tabeli, np. po rozłączeniu gracza
+    uint32_t journalId = 0;  // identyfikator w dzienniku ruchów; 0 po zapisaniu końca gry
+    std::shared_ptr<const WatcherList> watchers;
+    // Zmiany od ostatniej publikacji: nowi obserwatorzy i liczba unieważnionych wpisów.
+    WatcherList watcherJoins;
+    size_t staleWatchers = 0;
+    uint64_t secrets[2] = {0, 0};   // sekrety RESUME graczy
+    std::vector<HopRecord> history; // wszystkie skoki gry, do dosłania po RESUME
+    bool rated = false;             // wynik przekazany do rankingu
+    // Zegary: czas pozostały graczom w ms; zegar strony na posunięciu biegnie od turnStart.
+    int64_t clockMs[2] = {0, 0};
+    std::chrono::steady_clock::time_point turnStart;
+    TimerService* timers = nullptr;
+    ServerTimer clockTimer;
+    ServerTimer graceTimers[2];     // okresy karencji rozłączonych graczy
+
+    ~GameSession() {
+        if (timers) {
+            timers->cancel(clockTimer);
+            timers->cancel(graceTimers[0]);
+            timers->cancel(graceTimers[1]);
+        }
+        if (game) pool->release(game);
+    }
+};
+
+// Publikuje nową listę obserwatorów: ważne wpisy starej i dołączający od ostatniej publikacji.
+// Wołający trzyma session.mutex. Dzięki temu WATCH i jego koniec kosztują O(1) pod blokadą,
+// a kopia listy powstaje najwyżej raz na ruch albo gdy połowa wpisów jest nieważna.
+static void publishWatchers(GameSession& session) {
+    auto watchers = std::make_shared<WatcherList>();
+    size_t published = session.watchers ? session.watchers->size() : 0;
+    watchers->reserve(published + session.watcherJoins.size() - std::min(session.staleWatchers, published));
+    if (session.watchers) {
+        for (const Watcher& watcher : *session.watchers) {
+            if (watcher.active()) watchers->push_back(watcher);
         }
     }
+    for (Watcher& watcher : session.watcherJoins) {
+        if (watcher.active()) watchers->push_back(std::move(watcher));
+    }
+    session.watcherJoins.clear();
+    session.staleWatchers = 0;
+    session.watchers = std::move(watchers);
 }
 
-bool Game::checkGameEnd() {
-    if (whiteCount == 0) {
-        std::cout << "Gra zakończona: Czarny wygrywa!" << std::endl;
-        return true;
+// Wykonuje zweryfikowany skok w grze sesji i dopisuje go do historii; wołający trzyma session.mutex.
+static HopRecord applyHop(GameSession& session, int me, int fromX, int fromY, int toX, int toY) {
+    Game* game = session.game;
+    // Pobieramy współrzędne zbitego pionka przed wykonaniem ruchu; dalekie
+    // przesunięcie damki bez bicia nie jest biciem.
+    std::pair<int, int> captured = game->getCapturedCoordinatesForKing(fromX, fromY, toX, toY);
+    bool isCapture = abs(toX - fromX) > 1 && game->getPieceAt(captured.first, captured.second) != Game::EMPTY;
+    int capturedSq = isCapture ? squareIndex(captured.first, captured.second) : -1;
+    {
+        ScopedTimer timer(HIST_MAKE_MOVE);
+        game->makeMove(fromX, fromY, toX, toY, session.players[me]);
     }
-    if (blackCount == 0) {
-        std::cout << "Gra zakończona: Biały wygrywa!" << std::endl;
-        return true;
+    HopRecord hop{uint8_t(squareIndex(fromX, fromY)), uint8_t(squareIndex(toX, toY)), int8_t(capturedSq),
+                  game->isKingAt(toX, toY)};
+    session.history.push_back(hop);
+    return hop;
+}
+
+static OutMessage makeMoveUpdate(const HopRecord& hop) {
+    return makeMoveUpdate(squareRow(hop.from), squareCol(hop.from), squareRow(hop.to), squareCol(hop.to),
+                          hop.captured, hop.king);
+}
+
+// Tablica slotów z generacjami: uchwyt daje dostęp w O(1) bez kluczy tekstowych, a zwolnienie
+// slotu zwiększa generację, więc stare uchwyty przestają pasować. Sloty są rozłożone na shardy,
+// aby tworzenie i usuwanie gier w różnych wątkach nie konkurowało o jeden mutex.
+class GameTable {
+public:
+    static const uint32_t SHARD_COUNT = 64;
+    GameHandle add(const std::shared_ptr<GameSession>& session);
+    std::shared_ptr<GameSession> get(GameHandle handle);
+    // Zwalnia slot i zwraca usuniętą sesję (lub nullptr dla nieaktualnego uchwytu).
+    std::shared_ptr<GameSession> remove(GameHandle handle);
+private:
+    struct Slot {
+        uint32_t generation = 1;
+        std::shared_ptr<GameSession> session;
+    };
+    struct Shard {
+        std::mutex mutex;
+        std::vector<Slot> slots;
+        std::vector<uint32_t> freeSlots;
+    };
+    Shard shards[SHARD_COUNT];
+    std::atomic<uint32_t> nextShard{0};
+};
+
+GameHandle GameTable::add(const std::shared_ptr<GameSession>& session) {
+    uint32_t shardIndex = nextShard.fetch_add(1, std::memory_order_relaxed) % SHARD_COUNT;
+    Shard& shard = shards[shardIndex];
+    MeasuredLock lock(shard.mutex, HIST_WAIT_GAME_TABLE, COUNTER_LOCK_GAME_TABLE);
+    uint32_t local;
+    if (!shard.freeSlots.empty()) {
+        local = shard.freeSlots.back();
+        shard.freeSlots.pop_back();
+    } else {
+        local = uint32_t(shard.slots.size());
+        shard.slots.emplace_back();
     }
-    return false;
+    Slot& slot = shard.slots[local];
+    slot.session = session;
+    return (uint64_t(slot.generation) << 32) | (local * SHARD_COUNT + shardIndex);
 }
 
-void Game::setCurrentPlayer(int player) {
-    currentPlayer = player;
-}
-
-void Game::printBoard() {
-    std::cout << "\nAktualna plansza:\n";
-    for (int i = 0; i < BOARD_SIZE; i++) {
-        for (int j = 0; j < BOARD_SIZE; j++) {
-            if (board[i][j] == WHITE_PIECE) std::cout << "○ ";
-            else if (board[i][j] == BLACK_PIECE) std::cout << "● ";
-            else if (board[i][j] == WHITE_KING) std::cout << "♚ ";
-            else if (board[i][j] == BLACK_KING) std::cout << "♔ ";
-            else std::cout << ". ";
-        }
-        std::cout << std::endl;
-    }
-}
-
-std::string Game::getBoardState() const {
-    std::stringstream ss;
-    for (int i = 0; i < BOARD_SIZE; i++) {
-        for (int j = 0; j < BOARD_SIZE; j++) {
-            ss << board[i][j] << " ";
-        }
-    }
-    return ss.str();
-}
-
-std::vector<std::pair<int, int>> Game::getAvailableCaptures(int x, int y, bool isWhite) {
-    std::vector<std::pair<int, int>> captures;
-    int piece = board[x][y];
-    bool isKing = (piece == WHITE_KING || piece == BLACK_KING);
-    if (isKing) {
-        std::vector<std::pair<int, int>> directions = {{-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
-        for (const auto& dir : directions) {
-            int currentX = x + dir.first;
-            int currentY = y + dir.second;
-            while (currentX >= 0 && currentX < BOARD_SIZE && currentY >= 0 && currentY < BOARD_SIZE) {
-                if (board[currentX][currentY] != EMPTY) {
-                    bool isEnemy = false;
-                    if (isWhite && (board[currentX][currentY] == BLACK_PIECE || board[currentX][currentY] == BLACK_KING))
-                        isEnemy = true;
-                    if (!isWhite && (board[currentX][currentY] == WHITE_PIECE || board[currentX][currentY] == WHITE_KING))
-                        isEnemy = true;
-                    if (isEnemy) {
-                        int nextX = currentX + dir.first;
-                        int nextY = currentY + dir.second;
-                        while (nextX >= 0 && nextX < BOARD_SIZE && nextY >= 0 && nextY < BOARD_SIZE) {
-                            if (board[nextX][nextY] == EMPTY) {
-                                captures.push_back({nextX, nextY});
-                            } else {
-                                break;
-                            }
-                            nextX += dir.first;
-                            nextY += dir.second;
-                        }
-                    }
-                    break;
-                }
-                currentX += dir.first;
-                currentY += dir.second;
-            }
+std::shared_ptr<GameSession> GameTable::get(GameHandle handle) {
+    uint32_t index = uint32_t(handle);
+    uint32_t generation = uint32_t(handle >> 32);
+    Shard& shard = shards[index % SHARD_COUNT];
+    MeasuredLock lock(shard.mutex, HIST_WAIT_GAME_TABLE, COUNTER_LOCK_GAME_TABLE);
+    uint32_t local = index / SHARD_COUNT;
+    if (local >= shard.slots.size() || shard.slots[local].generation != generation) return nullptr;
+    return shard.slots[local].session;
+}
+
+std::shared_ptr<GameSession> GameTable::remove(GameHandle handle) {
+    uint32_t index = uint32_t(handle);
+    uint32_t generation = uint32_t(handle >> 32);
+    Shard& shard = shards[index % SHARD_COUNT];
+    MeasuredLock lock(shard.mutex, HIST_WAIT_GAME_TABLE, COUNTER_LOCK_GAME_TABLE);
+    uint32_t local = index / SHARD_COUNT;
+    if (local >= shard.slots.size() || shard.slots[local].generation != generation) return nullptr;
+    Slot& slot = shard.slots[local];
+    std::shared_ptr<GameSession> session = std::move(slot.session);
+    slot.session.reset();
+    if (++slot.generation == 0) slot.generation = 1;
+    shard.freeSlots.push_back(local);
+    return session;
+}
+
+// Pula wątków komputera: ruchy silnika są liczone poza pętlami zdarzeń, więc myślenie
+// komputera nie opóźnia obsługi gier między ludźmi.
+class BotPool {
+public:
+    void start(int workers);
+    void submit(std::function<void()> task);
+private:
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::function<void()>> tasks;
+    std::vector<std::thread> threads;
+    void run();
+};
+
+void BotPool::start(int workers) {
+    for (int i = 0; i < workers; i++) {
+        threads.emplace_back(&BotPool::run, this);
+    }
+}
+
+void BotPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    ready.notify_one();
+}
+
+void BotPool::run() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this] { return !tasks.empty(); });
+            task = std::move(tasks.front());
+            tasks.pop_front();
         }
-    } else {
-        std::vector<std::pair<int, int>> directions = {{-2, -2}, {-2, 2}, {2, -2}, {2, 2}};
-        for (const auto& dir : directions) {
-            int newX = x + dir.first;
-            int newY = y + dir.second;
-            int midX = x + dir.first/2;
-            int midY = y + dir.second/2;
-            if (newX >= 0 && newX < BOARD_SIZE && newY >= 0 && newY < BOARD_SIZE) {
-                if (board[newX][newY] == EMPTY) {
-                    int midPiece = board[midX][midY];
-                    if (isWhite && (midPiece == BLACK_PIECE || midPiece == BLACK_KING))
-                        captures.push_back({newX, newY});
-                    if (!isWhite && (midPiece == WHITE_PIECE || midPiece == WHITE_KING))
-                        captures.push_back({newX, newY});
-                }
-            }
+        task();
+    }
+}
+
+// Zgłoszenie dla wątku kojarzenia graczy.
+struct MatchEvent {
+    enum Type : uint8_t { JOIN, LEAVE, RESULT };
+    Type type = JOIN;
+    std::shared_ptr<Connection> conn;   // JOIN, LEAVE
+    PlayerId player = NO_PLAYER;        // JOIN; RESULT: biały
+    PlayerId opponent = NO_PLAYER;      // RESULT: czarny
+    int score = 0;                      // RESULT: 2 wygrana białego, 1 remis, 0 wygrana czarnego
+    std::string name;                   // JOIN
+    std::chrono::steady_clock::time_point since;   // JOIN
+};
+
+// Pojemność kolejki zgłoszeń; przy pełnej kolejce CONNECT dostaje SERVER_BUSY zamiast czekać.
+const size_t MATCH_QUEUE_CAPACITY = 1 << 16;
+// Co tyle wątek kojarzenia zbiera zgłoszenia i dobiera pary.
+const std::chrono::milliseconds MATCH_TICK(5);
+const int INITIAL_RATING = 1500;
+const int RATING_K = 32;
+// Dopuszczalna różnica rankingów rośnie z czasem oczekiwania, aby nikt nie czekał bez końca.
+const int RATING_BAND_BASE = 100;
+const int RATING_BAND_PER_SECOND = 200;
+
+// Poczekalnia i ranking Elo. Należy wyłącznie do wątku kojarzenia, więc nie ma blokad;
+// pozostałe wątki komunikują się z nią przez MatchEvent.
+class Matchmaker {
+public:
+    struct Waiting {
+        std::shared_ptr<Connection> conn;
+        PlayerId player;
+        std::string name;
+        int rating;
+        std::chrono::steady_clock::time_point since;
+    };
+    void apply(MatchEvent& event);
+    // Dobiera pary w jednej partii i usuwa je z poczekalni; w parze pierwszy czeka dłużej.
+    void pair(std::chrono::steady_clock::time_point now, std::vector<std::pair<Waiting, Waiting>>& out);
+    void requeue(Waiting&& waiting) { queued.insert(waiting.conn.get()); this->waiting.push_back(std::move(waiting)); }
+    size_t waitingCount() const { return queued.size(); }
+    int rating(PlayerId player) const { return player < ratings.size() ? ratings[player] : INITIAL_RATING; }
+private:
+    std::vector<Waiting> waiting;
+    // Połączenia, które nadal czekają; LEAVE usuwa je stąd, a wpis w waiting znika przy pair.
+    std::unordered_set<Connection*> queued;
+    std::vector<int> ratings;
+    static int band(std::chrono::steady_clock::time_point since, std::chrono::steady_clock::time_point now);
+};
+
+void Matchmaker::apply(MatchEvent& event) {
+    switch (event.type) {
+        case MatchEvent::JOIN:
+            if (!queued.insert(event.conn.get()).second) return;
+            waiting.push_back({std::move(event.conn), event.player, std::move(event.name), rating(event.player), event.since});
+            break;
+        case MatchEvent::LEAVE:
+            queued.erase(event.conn.get());
+            break;
+        case MatchEvent::RESULT: {
+            PlayerId last = std::max(event.player, event.opponent);
+            if (ratings.size() <= last) ratings.resize(last + 1, INITIAL_RATING);
+            int white = ratings[event.player], black = ratings[event.opponent];
+            double expected = 1.0 / (1.0 + std::pow(10.0, (black - white) / 400.0));
+            int delta = int(std::lround(RATING_K * (event.score / 2.0 - expected)));
+            ratings[event.player] = white + delta;
+            ratings[event.opponent] = black - delta;
+            break;
         }
     }
-    return captures;
 }
 
-std::vector<std::pair<int, int>> Game::getAllAvailableCaptures(bool isWhite) {
-    std::vector<std::pair<int, int>> allCaptures;
-    for (int x = 0; x < BOARD_SIZE; x++) {
-        for (int y = 0; y < BOARD_SIZE; y++) {
-            int piece = board[x][y];
-            if ((isWhite && (piece == WHITE_PIECE || piece == WHITE_KING)) ||
-                (!isWhite && (piece == BLACK_PIECE || piece == BLACK_KING))) {
-                auto captures = getAvailableCaptures(x, y, isWhite);
-                allCaptures.insert(allCaptures.end(), captures.begin(), captures.end());
-            }
+int Matchmaker::band(std::chrono::steady_clock::time_point since, std::chrono::steady_clock::time_point now) {
+    auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(now - since).count();
+    return RATING_BAND_BASE + int(std::min<int64_t>(waited, 3600 * 1000) * RATING_BAND_PER_SECOND / 1000);
+}
+
+// Zachłannie łączy sąsiadów w kolejności rankingu, jeśli różnica mieści się w przedziale
+// obu graczy; kto nie znalazł pary, czeka do następnej partii z szerszym przedziałem.
+void Matchmaker::pair(std::chrono::steady_clock::time_point now, std::vector<std::pair<Waiting, Waiting>>& out) {
+    waiting.erase(std::remove_if(waiting.begin(), waiting.end(),
+                                 [this](const Waiting& w) { return !queued.count(w.conn.get()); }),
+                  waiting.end());
+    if (waiting.size() < 2) return;
+    std::sort(waiting.begin(), waiting.end(), [](const Waiting& a, const Waiting& b) {
+        return a.rating != b.rating ? a.rating < b.rating : a.since < b.since;
+    });
+    std::vector<Waiting> left;
+    size_t i = 0;
+    while (i < waiting.size()) {
+        if (i + 1 < waiting.size() && waiting[i].player != waiting[i + 1].player &&
+            waiting[i + 1].rating - waiting[i].rating <= std::min(band(waiting[i].since, now), band(waiting[i + 1].since, now))) {
+            queued.erase(waiting[i].conn.get());
+            queued.erase(waiting[i + 1].conn.get());
+            if (waiting[i].since <= waiting[i + 1].since) out.emplace_back(std::move(waiting[i]), std::move(waiting[i + 1]));
+            else out.emplace_back(std::move(waiting[i + 1]), std::move(waiting[i]));
+            i += 2;
+        } else {
+            left.push_back(std::move(waiting[i]));
+            i++;
         }
     }
-    return allCaptures;
+    waiting.swap(left);
 }
 
-bool Game::isValidMove(int fromX, int fromY, int toX, int toY, bool isWhite) {
-    std::cout << "\nSprawdzanie ruchu: (" << fromX << "," << fromY << ") -> (" 
-              << toX << "," << toY << ") dla " << (isWhite ? "białego" : "czarnego") << std::endl;
-    if (fromX < 0 || fromX >= BOARD_SIZE || fromY < 0 || fromY >= BOARD_SIZE ||
-        toX < 0 || toX >= BOARD_SIZE || toY < 0 || toY >= BOARD_SIZE) {
-        std::cout << "Błąd: Ruch poza planszą" << std::endl;
-        return false;
+// Poziomy komputera, które w księdze otwarć losują ruch zamiast wybierać najlepszy wynik.
+const int BOOK_RANDOM_LEVELS = 2;
+// Tyle partii musi mieć pozycja po ruchu, aby jej wynik z księgi był brany pod uwagę.
+const uint32_t BOOK_MIN_GAMES = 10;
+
+// Ustawienia serwera z linii poleceń.
+struct ServerOptions {
+    int port = 12345;
+    int workerCount = 0;     // pętle zdarzeń; 0 = po jednej na rdzeń
+    int botThreads = -1;     // wątki pomocnicze przeszukiwania, wspólne dla gier z komputerem; -1 = domyślnie
+    size_t ttMegabytes = 64; // rozmiar tablicy transpozycji silnika
+    std::string journalPath; // dziennik ruchów; pusty = bez dziennika
+    int graceSeconds = 30;   // czas na RESUME po zerwaniu połączenia; 0 = gra kończy się od razu
+    int clockSeconds = 600;  // czas każdego gracza na całą partię; 0 = gra bez zegara
+    int incrementSeconds = 5;// doliczany po każdym zakończonym posunięciu
+    int idleSeconds = 300;   // zamykanie milczących połączeń poza trwającą grą; 0 = nigdy
+    std::string tablebasePath; // baza końcówek z tbgen; pusta = bez bazy
+    std::string bookPath;      // księga otwarć z analyze --book; pusta = bez księgi
+};
+
+class GameServer {
+private:
+    int serverSocket;
+    std::vector<std::unique_ptr<EventLoop>> loops;
+    size_t nextLoop = 0;
+    // Tablica graczy indeksowana PlayerId; nazwa jest szukana tylko raz, przy CONNECT.
+    struct PlayerEntry {
+        std::string name;
+        std::shared_ptr<Connection> connection;
+    };
+    std::vector<PlayerEntry> players;
+    std::unordered_map<std::string, PlayerId> playerIds;
+    GameTable games;
+    GamePool gamePool;
+    std::mutex playersMutex;
+    // Kojarzenie graczy: CONNECT tylko wrzuca zgłoszenie do kolejki bez blokad, a osobny wątek
+    // dobiera pary według rankingu i czasu oczekiwania.
+    MpmcQueue<MatchEvent> matchEvents{MATCH_QUEUE_CAPACITY};
+    std::atomic<size_t> matchWaiting{0};
+    std::thread matchThread;
+    BotPool botPool;
+    // Pomocnicy przeszukiwania dla wszystkich ruchów komputera. Razem z BOT_WORKERS domyślnie
+    // zajmują najwyżej połowę rdzeni, reszta zostaje pętlom zdarzeń graczy.
+    SearchPool searchPool;
+    int searchHelpers;
+    TranspositionTable transpositions;
+    EndgameTablebase tablebase;   // mapowana tylko do odczytu, wspólna dla wszystkich gier
+    OpeningBook book;             // jak baza końcówek
+    static const int BOT_WORKERS = 2;
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    MoveJournal journal;
+    // Gry odtworzone z dziennika czekają na powrót graczy; wpis znika przy ich CONNECT.
+    std::unordered_map<PlayerId, GameHandle> recoveredGames;
+    std::chrono::seconds gracePeriod;
+    std::chrono::milliseconds clockBase;       // 0 = gry bez zegara
+    std::chrono::milliseconds clockIncrement;
+    std::chrono::seconds idleTimeout;          // 0 = bez limitu bezczynności
+    // Wszystkie terminy serwera (zegary, karencja, bezczynność) obsługuje jeden wątek timerów.
+    TimerService timers;
+    std::thread timerThread;
+    PlayerId internPlayer(const std::string& name);
+public:
+    explicit GameServer(const ServerOptions& options);
+    void start();
+private:
+    void setupServer(int port);
+    void runEventLoop(EventLoop* loop);
+    void handleReadable(const std::shared_ptr<Connection>& conn);
+    void closeConnection(const std::shared_ptr<Connection>& conn);
+    void queueMessage(const std::shared_ptr<Connection>& conn, const std::shared_ptr<const std::string>& data);
+    void flushConnection(Connection& conn);
+    void flushPendingWrites();
+    void updateEpollEvents(Connection& conn);
+    void processCommand(std::string_view cmd, const std::shared_ptr<Connection>& conn);
+    void processBinaryFrame(uint8_t type, std::string_view payload, const std::shared_ptr<Connection>& conn);
+    void handleMove(const std::shared_ptr<Connection>& conn, int fromX, int fromY, int toX, int toY);
+    void handleBoardRequest(const std::shared_ptr<Connection>& conn);
+    void handleBookRequest(const std::shared_ptr<Connection>& conn);
+    void handlePlayBot(const std::shared_ptr<Connection>& conn, int level);
+    void handleStats(const std::shared_ptr<Connection>& conn);
+    void handleWatch(const std::shared_ptr<Connection>& conn, uint64_t gameId);
+    void stopWatching(const std::shared_ptr<Connection>& conn);
+    void broadcastToWatchers(GameSession& session, const OutMessage& message);
+    void playHop(GameSession& session, int me, int fromX, int fromY, int toX, int toY);
+    bool finishIfOver(GameSession& session);
+    void scheduleBotMove(const std::shared_ptr<GameSession>& session);
+    void playBotMove(const std::shared_ptr<GameSession>& session);
+    bool pickBookMove(const Board& board, int level, Move& move);
+    void forfeitBot(GameSession& session);
+    void sendToConnection(const std::shared_ptr<Connection>& conn, const OutMessage& message);
+    void sendToPlayer(GameSession& session, int index, const OutMessage& message);
+    void removePlayer(const std::shared_ptr<Connection>& conn);
+    std::shared_ptr<GameSession> createGame(PlayerId player1, PlayerId player2, const std::string& name1,
+                                            const std::string& name2, int botLevel = 0);
+    void runMatchmaker();
+    bool startMatchedGame(Matchmaker::Waiting& white, Matchmaker::Waiting& black, Matchmaker& matchmaker);
+    void removeGame(GameHandle handle);
+    void journalEnd(GameSession& session);
+    void recoverGames(const std::string& path);
+    void resumeGame(const std::shared_ptr<Connection>& conn, const std::shared_ptr<GameSession>& session);
+    void handleResume(const std::shared_ptr<Connection>& conn, GameHandle gameId, uint64_t secret, uint32_t seenHops);
+    void sendResumeState(GameSession& session, int me, uint32_t seenHops);
+    void startGrace(GameSession& session, int index);
+    void abandonGame(GameSession& session, int leaver);
+    void endSession(GameSession& session);
+    void reportResult(GameSession& session, int whiteScore);
+    void runTimers();
+    void handleTimer(const ExpiredTimer& timer);
+    void checkIdle(const std::shared_ptr<Connection>& conn);
+    bool inLiveGame(GameHandle handle);
+    void startClock(GameSession& session);
+    void switchClock(GameSession& session, int me);
+    bool clockExpired(GameSession& session, int side);
+    OutMessage clockMessage(GameSession& session);
+    void flagFall(GameSession& session, int side);
+};
+
+GameServer::GameServer(const ServerOptions& options)
+    : searchHelpers(options.botThreads >= 0 ? options.botThreads
+                                             : std::max(0, int(std::thread::hardware_concurrency() / 2) - BOT_WORKERS)),
+      gracePeriod(std::max(0, options.graceSeconds)),
+      clockBase(std::chrono::seconds(std::max(0, options.clockSeconds))),
+      clockIncrement(std::chrono::seconds(std::max(0, options.incrementSeconds))),
+      idleTimeout(std::max(0, options.idleSeconds)) {
+    setupServer(options.port);
+    transpositions.resize(options.ttMegabytes);
+    LOG_INFO("Tablica transpozycji: %zu wpisów (%zu MB)", transpositions.size(), options.ttMegabytes);
+    LOG_INFO("Komputer: %d wątki ruchów i %d wątków pomocniczych przeszukiwania", BOT_WORKERS, searchHelpers);
+    int workerCount = options.workerCount;
+    if (workerCount <= 0) workerCount = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 0; i < workerCount; i++) {
+        auto loop = std::make_unique<EventLoop>();
+        loop->epollFd = epoll_create1(0);
+        if (loop->epollFd < 0) {
+            perror("Tworzenie epoll nie powiodło się");
+            exit(1);
+        }
+        loops.push_back(std::move(loop));
     }
-    if (board[toX][toY] != EMPTY) {
-        std::cout << "Błąd: Pole docelowe nie jest puste" << std::endl;
-        return false;
+    if (!options.tablebasePath.empty() && !tablebase.open(options.tablebasePath)) {
+        perror("Wczytanie bazy końcówek nie powiodło się");
+        exit(1);
     }
-    std::cout << "Wartości enum:" << std::endl;
-    std::cout << "WHITE_PIECE = " << WHITE_PIECE << std::endl;
-    std::cout << "BLACK_PIECE = " << BLACK_PIECE << std::endl;
-    std::cout << "WHITE_KING = " << WHITE_KING << std::endl;
-    std::cout << "BLACK_KING = " << BLACK_KING << std::endl;
-    int piece = board[fromX][fromY];
-    std::cout << "Wartość pionka na polu (" << fromX << "," << fromY << ") = " << piece << std::endl;
-    if (piece == EMPTY) {
-        std::cout << "Błąd: Brak pionka na polu startowym" << std::endl;
-        return false;
+    if (!options.bookPath.empty() && !book.open(options.bookPath)) {
+        perror("Wczytanie księgi otwarć nie powiodło się");
+        exit(1);
     }
-    bool isKing = (piece == WHITE_KING || piece == BLACK_KING);
-    std::cout << "Typ pionka: " << (isKing ? "damka" : "zwykły")
-              << " (wartość=" << piece << ")" << std::endl;
-    if ((isWhite && (piece != WHITE_PIECE && piece != WHITE_KING)) ||
-        (!isWhite && (piece != BLACK_PIECE && piece != BLACK_KING))) {
-        std::cout << "Błąd: Nieprawidłowy kolor pionka (piece=" << piece 
-                  << ", isWhite=" << isWhite << ")" << std::endl;
-        return false;
+    if (!options.journalPath.empty()) recoverGames(options.journalPath);
+}
+
+// Odtwarza trwające gry z dziennika, zapisuje go od nowa tylko z nimi i otwiera do dopisywania.
+// Ruchy są powtarzane przez Game::isValidMove/makeMove, więc uszkodzony wpis odrzuca tylko
+// swoją grę. Wywoływane przed startem wątków.
+void GameServer::recoverGames(const std::string& path) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<JournalGame> entries;
+    uint32_t nextId;
+    if (!MoveJournal::recover(path, entries, nextId)) {
+        perror("Odczyt dziennika ruchów nie powiódł się");
+        exit(1);
     }
-    int dx = toX - fromX;
-    int dy = toY - fromY;
-    auto allCaptures = getAllAvailableCaptures(isWhite);
-    if (!allCaptures.empty()) {
-        std::cout << "Dostępne bicia:" << std::endl;
-        for (const auto& capture : allCaptures) {
-            std::cout << "Możliwe bicie na pozycję (" 
-                      << capture.first << "," << capture.second << ")" << std::endl;
-        }
-        std::cout << "Przed sprawdzeniem czy to damka czy nie - isKing: " << isKing << std::endl;
-        if (isKing) {
-            std::cout << "Sprawdzamy bicie damki" << std::endl;
-            std::cout << "abs(dx) i abs(dy): " << abs(dx) << "   " << abs(dy) << std::endl;
-            if (abs(dx) != abs(dy)) {
-                std::cout << "Błąd: Ruch damki musi być po przekątnej" << std::endl;
-                return false;
-            }
-            int stepX = (dx > 0) ? 1 : -1;
-            int stepY = (dy > 0) ? 1 : -1;
-            std::cout << "stepX, stepY: " << stepX << "   " << stepY << std::endl;
-            int currentX = fromX + stepX;
-            int currentY = fromY + stepY;
-            int enemyCount = 0;
-            while (currentX != toX && currentY != toY) {
-                std::cout << "enemyCount: " << enemyCount << std::endl;
-                if (board[currentX][currentY] != EMPTY) {
-                    bool isEnemy = false;
-                    if (isWhite && (board[currentX][currentY] == BLACK_PIECE || board[currentX][currentY] == BLACK_KING))
-                        isEnemy = true;
-                    if (!isWhite && (board[currentX][currentY] == WHITE_PIECE || board[currentX][currentY] == WHITE_KING))
-                        isEnemy = true;
-                    if (!isEnemy) {
-                        std::cout << "Błąd: Na drodze damki znajduje się pionek własny" << std::endl;
-                        return false;
-                    }
-                    enemyCount++;
-                    if (enemyCount > 1) {
-                        std::cout << "Błąd: Na drodze damki jest więcej niż jeden pionek przeciwnika" << std::endl;
-                        return false;
-                    }
-                }
-                currentX += stepX;
-                currentY += stepY;
-            }
-            if (enemyCount == 1) {
-                std::cout << "check if (enemyCount == 1): " << enemyCount << std::endl;
-                auto currentCaptures = getAvailableCaptures(fromX, fromY, isWhite);
-                for (const auto& cap : currentCaptures) {
-                    if (cap.first == toX && cap.second == toY) {
-                        std::cout << "Prawidłowe bicie damką" << std::endl;
-                        return true;
-                    }
-                }
-                std::cout << "Błąd: Ruch damki nie znajduje się na liście dostępnych bić" << std::endl;
-                return false;
-            } else {
-                std::cout << "Błąd: Ruch damki musi przebiegać przez dokładnie jeden pionek przeciwnika" << std::endl;
-                return false;
-            }
-        } else {
-            std::cout << "else - nie sprawdzamy bicia damki tylko bicie piona" << std::endl;
-            if (abs(dx) == 2 && abs(dy) == 2) {
-                int midX = (fromX + toX) / 2;
-                int midY = (fromY + toY) / 2;
-                int midPiece = board[midX][midY];
-                std::cout << "Próba bicia - sprawdzam pionek na (" << midX << "," << midY 
-                          << "), wartość=" << midPiece << std::endl;
-                if (isWhite && (midPiece == BLACK_PIECE || midPiece == BLACK_KING)) {
-                    auto currentCaptures = getAvailableCaptures(fromX, fromY, isWhite);
-                    for (const auto& cap : currentCaptures) {
-                        if (cap.first == toX && cap.second == toY) {
-                            std::cout << "Prawidłowe bicie dla białego" << std::endl;
-                            return true;
-                        }
-                    }
-                }
-                if (!isWhite && (midPiece == WHITE_PIECE || midPiece == WHITE_KING)) {
-                    auto currentCaptures = getAvailableCaptures(fromX, fromY, isWhite);
-                    for (const auto& cap : currentCaptures) {
-                        if (cap.first == toX && cap.second == toY) {
-                            std::cout << "Prawidłowe bicie dla czarnego" << std::endl;
-                            return true;
-                        }
-                    }
-                }
-            }
-            std::cout << "Błąd: Musisz wykonać dostępne bicie" << std::endl;
-            return false;
-        }
-    }
-    if (isKing) {
-        std::cout << "Sprawdzanie ruchu damki" << std::endl;
-        if (abs(dx) != abs(dy)) {
-            std::cout << "Błąd: Ruch damki musi być po przekątnej" << std::endl;
-            return false;
-        }
-        int stepX = (dx > 0) ? 1 : -1;
-        int stepY = (dy > 0) ? 1 : -1;
-        int currentX = fromX + stepX;
-        int currentY = fromY + stepY;
-        while (currentX != toX && currentY != toY) {
-            if (board[currentX][currentY] != EMPTY) {
-                std::cout << "Błąd: Droga ruchu damki jest zablokowana" << std::endl;
-                return false;
-            }
-            currentX += stepX;
-            currentY += stepY;
+    std::vector<JournalGame> restored;
+    restored.reserve(entries.size());
+    for (JournalGame& entry : entries) {
+        if (entry.names[0].empty() || entry.names[1].empty()) continue;
+        PlayerId black = entry.botLevel != 0 ? BOT_PLAYER : internPlayer(entry.names[1]);
+        auto session = createGame(internPlayer(entry.names[0]), black, entry.names[0], entry.names[1], entry.botLevel);
+        std::lock_guard<std::mutex> sessionLock(session->mutex, std::adopt_lock);
+        session->journalId = entry.id;
+        Game* game = session->game;
+        bool valid = true;
+        for (size_t i = 0; i + 1 < entry.hops.size() && valid; i += 2) {
+            int from = entry.hops[i], to = entry.hops[i + 1];
+            bool isWhite = game->getCurrentPlayer() == 1;
+            valid = from < 32 && to < 32 &&
+                    game->isValidMove(squareRow(from), squareCol(from), squareRow(to), squareCol(to), isWhite);
+            if (!valid) break;
+            applyHop(*session, isWhite ? 0 : 1, squareRow(from), squareCol(from), squareRow(to), squareCol(to));
+            if (!game->isCaptureChainPending()) game->setCurrentPlayer(isWhite ? 2 : 1);
         }
-        std::cout << "Prawidłowy ruch damki bez bicia" << std::endl;
-        return true;
-    } else {
-        std::cout << "Sprawdzanie ruchu zwykłego pionka" << std::endl;
-        if (abs(dx) != 1 || abs(dy) != 1) {
-            std::cout << "Błąd: Ruch musi być o jedno pole po przekątnej" << std::endl;
-            return false;
-        }
-        if (isWhite && dx != -1) {
-            std::cout << "Błąd: Nieprawidłowy kierunek ruchu dla białego pionka" << std::endl;
-            return false;
-        }
-        if (!isWhite && dx != 1) {
-            std::cout << "Błąd: Nieprawidłowy kierunek ruchu dla czarnego pionka" << std::endl;
-            return false;
-        }
-        std::cout << "Prawidłowy ruch zwykłego pionka" << std::endl;
-        return true;
-    }
-}
-
-void Game::makeMove(int fromX, int fromY, int toX, int toY, const std::string& playerName) {
-    int movedPiece = board[fromX][fromY];
-    std::cout << "Poruszany pionek (movedPiece) = " << movedPiece << std::endl;
-    bool isKing = (movedPiece == WHITE_KING || movedPiece == BLACK_KING);
-    bool isWhite = (playerName == player1);
-    board[toX][toY] = movedPiece;
-    board[fromX][fromY] = EMPTY;
-    if (abs(toX - fromX) > 1) {
-        if (isKing) {
-            int stepX = (toX - fromX) > 0 ? 1 : -1;
-            int stepY = (toY - fromY) > 0 ? 1 : -1;
-            int currentX = fromX + stepX;
-            int currentY = fromY + stepY;
-            bool foundEnemy = false;
-            while (currentX != toX && currentY != toY) {
-                if (board[currentX][currentY] != EMPTY) {
-                    std::cout << "Zbicie pionka na pozycji (" << currentX << "," << currentY << ")" << std::endl;
-                    board[currentX][currentY] = EMPTY;
-                    if (isWhite) blackCount--; else whiteCount--;
-                    foundEnemy = true;
-                    break;
-                }
-                currentX += stepX;
-                currentY += stepY;
-            }
-        } else {
-            int midX = (fromX + toX) / 2;
-            int midY = (fromY + toY) / 2;
-            board[midX][midY] = EMPTY;
-            if (isWhite) blackCount--; else whiteCount--;
+        if (!valid || game->checkGameEnd()) {
+            if (!valid) LOG_WARN("Dziennik: niedozwolony ruch w grze %u, gra pominięta", entry.id);
+            session->finished = true;
+            games.remove(session->handle);
+            continue;
         }
+        // Gracze mają tyle samo czasu na powrót co po zerwanym połączeniu.
+        for (int i = 0; i < (session->botLevel == 0 ? 2 : 1); i++) {
+            recoveredGames[session->players[i]] = session->handle;
+            if (gracePeriod.count() > 0) startGrace(*session, i);
+        }
+        // Czas zużyty przed restartem nie jest zapisywany; zegary startują od pełnej puli.
+        startClock(*session);
+        restored.push_back(std::move(entry));
+    }
+    if (!MoveJournal::rewrite(path, restored) || !journal.open(path, nextId)) {
+        perror("Zapis dziennika ruchów nie powiódł się");
+        exit(1);
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO("Dziennik ruchów %s: odtworzono %zu gier w %.0f ms", path.c_str(), restored.size(), ms);
+}
+
+// Gracz odtworzonej gry wrócił: podpinamy połączenie i wysyłamy pełny stan zamiast
+// komunikatów startowych od zera.
+void GameServer::resumeGame(const std::shared_ptr<Connection>& conn, const std::shared_ptr<GameSession>& session) {
+    MeasuredLock lock(session->mutex, HIST_WAIT_SESSION, COUNTER_LOCK_SESSION);
+    if (session->finished) return;
+    int me = (session->players[0] == conn->playerId) ? 0 : 1;
+    session->connections[me] = conn;
+    timers.cancel(session->graceTimers[me]);
+    conn->game.store(session->handle);
+    LOG_INFO("Gracz %s wraca do odtworzonej gry", conn->playerName.c_str());
+    sendToPlayer(*session, me, me == 0 ? MSG_COLOR_WHITE : MSG_COLOR_BLACK);
+    sendToPlayer(*session, me, MSG_GAME_START);
+    sendToPlayer(*session, me, makeGameIdMessage(session->handle));
+    sendToPlayer(*session, me, makeSessionMessage(session->handle, session->secrets[me]));
+    // Klient nie zna żadnego skoku tej gry, więc dostaje migawkę planszy.
+    sendResumeState(*session, me, UINT32_MAX);
+    sendToPlayer(*session, 1 - me, MSG_OPPONENT_BACK);
+    scheduleBotMove(session);
+}
+
+// Dosyła graczowi brakujące skoki z historii albo migawkę planszy, a potem stan tury;
+// wołający trzyma session.mutex.
+void GameServer::sendResumeState(GameSession& session, int me, uint32_t seenHops) {
+    Game* game = session.game;
+    uint32_t total = uint32_t(session.history.size());
+    bool delta = seenHops <= total && total - seenHops <= MAX_RESUME_DELTA;
+    metricCount(delta ? COUNTER_RESUMES_DELTA : COUNTER_RESUMES_SNAPSHOT);
+    sendToPlayer(session, me, makeResumedMessage(me, delta ? seenHops : total));
+    if (delta) {
+        for (uint32_t i = seenHops; i < total; i++) sendToPlayer(session, me, makeMoveUpdate(session.history[i]));
+    } else {
+        sendToPlayer(session, me, makeBoardMessage(*game));
+    }
+    std::string result = gameResult(*game);
+    if (!result.empty()) {
+        sendToPlayer(session, me, makeGameOver(result));
+    } else {
+        if (clockBase.count() > 0) sendToPlayer(session, me, clockMessage(session));
+        sendToPlayer(session, me, game->getCurrentPlayer() == me + 1 ? MSG_YOUR_TURN : MSG_WAIT_TURN);
+    }
+}
+
+// Gracz wraca na nowym połączeniu z tokenem z SESSION. Wołane zamiast CONNECT.
+void GameServer::handleResume(const std::shared_ptr<Connection>& conn, GameHandle gameId, uint64_t secret,
+                              uint32_t seenHops) {
+    if (conn->playerId != NO_PLAYER || secret == 0) {
+        sendToConnection(conn, MSG_NO_GAME_FOUND);
+        return;
+    }
+    MeasuredLock playersLock(playersMutex, HIST_WAIT_PLAYERS, COUNTER_LOCK_PLAYERS);
+    auto session = games.get(gameId);
+    if (!session) {
+        sendToConnection(conn, MSG_NO_GAME_FOUND);
+        return;
+    }
+    MeasuredLock lock(session->mutex, HIST_WAIT_SESSION, COUNTER_LOCK_SESSION);
+    int me = session->secrets[0] == secret ? 0 : session->secrets[1] == secret ? 1 : -1;
+    if (session->finished || me < 0) {
+        sendToConnection(conn, MSG_NO_GAME_FOUND);
+        return;
+    }
+    std::shared_ptr<Connection> previous = std::move(session->connections[me]);
+    if (previous) {
+        // Stare połączenie jeszcze nie wykryło zerwania: odpinamy je od gry i zamykamy.
+        previous->game.store(NO_GAME);
+        std::lock_guard<std::mutex> writeLock(previous->writeMutex);
+        if (!previous->closed) shutdown(previous->fd, SHUT_RDWR);
     }
-    std::cout << "Sprawdzanie promocji:" << std::endl;
-    std::cout << "isKing = " << isKing << std::endl;
-    std::cout << "isWhite = " << isWhite << std::endl;
-    std::cout << "toX = " << toX << std::endl;
-    std::cout << "BOARD_SIZE - 1 = " << (BOARD_SIZE - 1) << std::endl;
-    if (!isKing) {
-        if ((isWhite && toX == 0) || (!isWhite && toX == BOARD_SIZE - 1)) {
-            board[toX][toY] = isWhite ? WHITE_KING : BLACK_KING;
-            std::cout << "Promocja na damkę! Kolor: " << (isWhite ? "biały" : "czarny") << std::endl;
+    metricCount(COUNTER_PLAYERS_JOINED);
+    PlayerId player = session->players[me];
+    conn->playerId = player;
+    conn->setName(players[player].name);
+    players[player].connection = conn;
+    session->connections[me] = conn;
+    timers.cancel(session->graceTimers[me]);
+    conn->game.store(session->handle);
+    LOG_INFO("Gracz %s wznawia grę (otrzymał %u skoków z %zu)", conn->playerName.c_str(), seenHops,
+             session->history.size());
+    sendResumeState(*session, me, seenHops);
+    sendToPlayer(*session, 1 - me, MSG_OPPONENT_BACK);
+    broadcastToWatchers(*session, MSG_OPPONENT_BACK);
+}
+
+// Gracz o indeksie index zerwał połączenie; wołający trzyma session.mutex.
+void GameServer::startGrace(GameSession& session, int index) {
+    timers.schedule(session.graceTimers[index], std::chrono::steady_clock::now() + gracePeriod);
+}
+
+// Kończy grę po odejściu gracza leaver; wołający trzyma session.mutex. Uchwyt przeciwnika
+// traci ważność razem ze slotem.
+void GameServer::abandonGame(GameSession& session, int leaver) {
+    endSession(session);
+    sendToPlayer(session, 1 - leaver, MSG_OPPONENT_DISCONNECTED);
+    broadcastToWatchers(session, MSG_OPPONENT_DISCONNECTED);
+}
+
+// Usuwa sesję z tablicy i zatrzymuje jej timery; wołający trzyma session.mutex. Game wraca
+// do puli, gdy znikną ostatnie odwołania do sesji (np. zadanie komputera w toku).
+void GameServer::endSession(GameSession& session) {
+    session.finished = true;
+    journalEnd(session);
+    timers.cancel(session.clockTimer);
+    timers.cancel(session.graceTimers[0]);
+    timers.cancel(session.graceTimers[1]);
+    games.remove(session.handle);
+}
+
+// Przekazuje wynik gry ludzi do rankingu, raz na sesję; whiteScore: 2 wygrana białego,
+// 1 remis, 0 przegrana. Wołający trzyma session.mutex.
+void GameServer::reportResult(GameSession& session, int whiteScore) {
+    if (session.botLevel != 0 || session.rated) return;
+    session.rated = true;
+    MatchEvent event;
+    event.type = MatchEvent::RESULT;
+    event.player = session.players[0];
+    event.opponent = session.players[1];
+    event.score = whiteScore;
+    if (!matchEvents.push(std::move(event))) LOG_WARN("Kolejka kojarzenia pełna, wynik gry nie trafi do rankingu");
+}
+
+// Wątek timerów: co TIMER_TICK przesuwa koło i obsługuje wszystko, co w tym czasie wygasło.
+void GameServer::runTimers() {
+    std::vector<ExpiredTimer> expired;
+    while (true) {
+        std::this_thread::sleep_for(TIMER_TICK);
+        timers.collect(std::chrono::steady_clock::now(), expired);
+        for (const ExpiredTimer& timer : expired) handleTimer(timer);
+        expired.clear();
+        flushPendingWrites();
+    }
+}
+
+// Wygaśnięcie jest nieaktualne, gdy timer przestawiono lub anulowano po jego zebraniu
+// (np. ruch albo RESUME w ostatniej chwili).
+void GameServer::handleTimer(const ExpiredTimer& timer) {
+    if (timer.kind == TIMER_IDLE) {
+        if (timer.conn) checkIdle(timer.conn);
+        return;
+    }
+    auto session = games.get(timer.handle);
+    if (!session) return;
+    MeasuredLock lock(session->mutex, HIST_WAIT_SESSION, COUNTER_LOCK_SESSION);
+    if (session->finished) return;
+    if (timer.kind == TIMER_GRACE) {
+        if (!timers.isCurrent(session->graceTimers[timer.index], timer.generation) ||
+            session->connections[timer.index]) {
+            return;
         }
+        LOG_INFO("Gracz nie wrócił do gry %llu w okresie karencji, koniec gry", (unsigned long long)timer.handle);
+        metricCount(COUNTER_GRACE_EXPIRED);
+        abandonGame(*session, timer.index);
+        return;
+    }
+    if (!timers.isCurrent(session->clockTimer, timer.generation)) return;
+    int side = session->game->getCurrentPlayer() - 1;
+    if (clockExpired(*session, side)) {
+        flagFall(*session, side);
+    } else {
+        timers.schedule(session->clockTimer, session->turnStart + std::chrono::milliseconds(session->clockMs[side]));
     }
-    printBoard();
 }
 
-int Game::getCurrentPlayer() const {
-    return currentPlayer;
+// Gracz lub obserwator trwającej gry może długo milczeć; martwego klienta w grze rozstrzyga zegar.
+bool GameServer::inLiveGame(GameHandle handle) {
+    auto session = games.get(handle);
+    if (!session) return false;
+    MeasuredLock lock(session->mutex, HIST_WAIT_SESSION, COUNTER_LOCK_SESSION);
+    return !session->finished && gameResult(*session->game).empty();
 }
 
-std::string Game::getOpponent(const std::string& player) {
-    return (player == player1) ? player2 : player1;
+// Zamyka połączenie, z którego nic nie przyszło przez idleTimeout. Odczyty tylko zapisują
+// lastActivityMs, więc timer jest przestawiany dopiero tutaj, najwyżej raz na idleTimeout.
+void GameServer::checkIdle(const std::shared_ptr<Connection>& conn) {
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point lastActivity{
+        std::chrono::milliseconds(conn->lastActivityMs.load(std::memory_order_relaxed))};
+    if (now - lastActivity < idleTimeout) {
+        timers.schedule(conn->idleTimer, lastActivity + idleTimeout);
+        return;
+    }
+    if (inLiveGame(conn->game.load()) || inLiveGame(conn->watching.load())) {
+        timers.schedule(conn->idleTimer, now + idleTimeout);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(conn->writeMutex);
+    if (conn->closed) return;
+    LOG_INFO("Połączenie %s bezczynne od %lld s, zamykanie", conn->displayName(),
+             (long long)std::chrono::duration_cast<std::chrono::seconds>(now - lastActivity).count());
+    metricCount(COUNTER_IDLE_CLOSED);
+    // Jak przy przepełnionej kolejce: shutdown budzi pętlę zdarzeń, która zamknie połączenie.
+    shutdown(conn->fd, SHUT_RDWR);
 }
 
-std::string Game::getPlayer1() const {
-    return player1;
+// Uruchamia zegar białego na początku gry; wołający trzyma session.mutex.
+void GameServer::startClock(GameSession& session) {
+    if (clockBase.count() == 0) return;
+    session.clockMs[0] = session.clockMs[1] = clockBase.count();
+    session.turnStart = std::chrono::steady_clock::now();
+    timers.schedule(session.clockTimer, session.turnStart + clockBase);
+    OutMessage clock = clockMessage(session);
+    sendToPlayer(session, 0, clock);
+    sendToPlayer(session, 1, clock);
+    broadcastToWatchers(session, clock);
 }
 
+// Gracz me zakończył posunięcie: jego czas maleje o zużyty i rośnie o przyrost, a timer sesji
+// przechodzi na termin przeciwnika. Wołający trzyma session.mutex.
+void GameServer::switchClock(GameSession& session, int me) {
+    if (clockBase.count() == 0) return;
+    auto now = std::chrono::steady_clock::now();
+    session.clockMs[me] -= std::chrono::duration_cast<std::chrono::milliseconds>(now - session.turnStart).count();
+    session.clockMs[me] = std::max<int64_t>(session.clockMs[me], 0) + clockIncrement.count();
+    session.turnStart = now;
+    timers.schedule(session.clockTimer, now + std::chrono::milliseconds(session.clockMs[1 - me]));
+    OutMessage clock = clockMessage(session);
+    sendToPlayer(session, 0, clock);
+    sendToPlayer(session, 1, clock);
+    broadcastToWatchers(session, clock);
+}
 
-bool Game::isKingAt(int x, int y) {
-    int piece = board[x][y];
-    return (piece == WHITE_KING || piece == BLACK_KING);
+// Czy gracz side jest na posunięciu i skończył mu się czas; wołający trzyma session.mutex.
+bool GameServer::clockExpired(GameSession& session, int side) {
+    if (clockBase.count() == 0 || session.game->getCurrentPlayer() != side + 1) return false;
+    return std::chrono::steady_clock::now() - session.turnStart >= std::chrono::milliseconds(session.clockMs[side]);
 }
 
-std::pair<int, int> Game::getCapturedCoordinatesForKing(int fromX, int fromY, int toX, int toY) {
-    int stepX = (toX - fromX) > 0 ? 1 : -1;
-    int stepY = (toY - fromY) > 0 ? 1 : -1;
-    int currentX = fromX + stepX;
-    int currentY = fromY + stepY;
-    while (currentX != toX && currentY != toY) {
-         if (board[currentX][currentY] != EMPTY) {
-              return {currentX, currentY};
-         }
-         currentX += stepX;
-         currentY += stepY;
+// Stan zegarów na teraz; wołający trzyma session.mutex.
+OutMessage GameServer::clockMessage(GameSession& session) {
+    int64_t remaining[2] = {session.clockMs[0], session.clockMs[1]};
+    int side = session.game->getCurrentPlayer() - 1;
+    if (side == 0 || side == 1) {
+        remaining[side] -= std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - session.turnStart).count();
     }
-    return { (fromX + toX) / 2, (fromY + toY) / 2 };
+    return makeClockMessage(remaining[0], remaining[1]);
 }
 
-int Game::getPieceAt(int x, int y) {
-    return board[x][y];
+// Gracz side przekroczył czas: przegrywa, a sesja od razu znika z tablicy i oddaje Game do puli.
+// Wołający trzyma session.mutex.
+void GameServer::flagFall(GameSession& session, int side) {
+    LOG_INFO("Gra %llu: %s przekroczył czas", (unsigned long long)session.handle, side == 0 ? "biały" : "czarny");
+    metricCount(COUNTER_FLAG_FALLS);
+    OutMessage gameOver = makeGameOver(side == 0 ? "black" : "white", true);
+    sendToPlayer(session, 0, gameOver);
+    sendToPlayer(session, 1, gameOver);
+    broadcastToWatchers(session, gameOver);
+    reportResult(session, side == 0 ? 0 : 2);
+    endSession(session);
 }
 
-class GameServer {
-private:
-    int serverSocket;
-    std::map<std::string, int> connectedPlayers;
-    std::map<std::string, Game*> activeGames;
-    std::map<std::string, std::string> playerToGameId;
-    std::map<std::string, std::set<std::string>> gamePlayerMap;
-    std::map<std::string, bool> playerMultiCaptureMode;
-    std::mutex playersMutex, gamesMutex;
-    std::queue<std::string> waitingPlayers;
-    std::string generateGameId(const std::string& player1, const std::string& player2) {
-        return player1 + "_vs_" + player2 + "_" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+// Zwraca sesję zablokowaną, aby komunikaty startowe zostały wysłane przed jakimkolwiek ruchem
+// w tej grze. Połączenia graczy podpina wołający.
+std::shared_ptr<GameSession> GameServer::createGame(PlayerId player1, PlayerId player2, const std::string& name1,
+                                                    const std::string& name2, int botLevel) {
+    auto session = std::make_shared<GameSession>();
+    session->pool = &gamePool;
+    session->game = gamePool.acquire(player1, player2);
+    session->players[0] = player1;
+    session->players[1] = player2;
+    session->botLevel = botLevel;
+    session->secrets[0] = newSessionSecret();
+    // Za komputer nikt nie wznawia gry; sekret 0 jest odrzucany przez RESUME.
+    session->secrets[1] = botLevel != 0 ? 0 : newSessionSecret();
+    session->timers = &timers;
+    session->clockTimer.kind = TIMER_CLOCK;
+    for (int i = 0; i < 2; i++) {
+        session->graceTimers[i].kind = TIMER_GRACE;
+        session->graceTimers[i].index = i;
     }
-public:
-    GameServer(int port);
-    void start();
-private:
-    void setupServer(int port);
-    void handleClient(int clientSocket);
-    void processCommand(const std::string& cmd, int clientSocket, std::string& playerName);
-    void sendMessage(const std::string& player, const std::string& message);
-    void removePlayer(const std::string& playerName);
-    void createGame(const std::string& player1, const std::string& player2);
-    void removeGame(const std::string& gameId);
-};
+    if (journal.enabled()) {
+        session->journalId = journal.newGameId();
+        journal.logStart(session->journalId, uint8_t(botLevel), name1, name2);
+    }
+    session->mutex.lock();
+    session->handle = games.add(session);
+    session->clockTimer.handle = session->graceTimers[0].handle = session->graceTimers[1].handle = session->handle;
+    return session;
+}
 
-GameServer::GameServer(int port) {
-    setupServer(port);
+// Zajmuje wolne połączenie na czas tworzenia gry. CAS na Connection::game gwarantuje, że gracz
+// nie trafi do dwóch gier naraz (np. PLAY_BOT w trakcie kojarzenia), a zamknięte połączenie
+// nie dostanie nowej gry.
+static bool claimConnection(Connection& conn) {
+    GameHandle expected = NO_GAME;
+    if (!conn.game.compare_exchange_strong(expected, PAIRING_GAME)) return false;
+    std::lock_guard<std::mutex> lock(conn.writeMutex);
+    if (!conn.closed) return true;
+    expected = PAIRING_GAME;
+    conn.game.compare_exchange_strong(expected, NO_GAME);
+    return false;
 }
 
-void GameServer::createGame(const std::string& player1, const std::string& player2) {
-    std::string gameId = generateGameId(player1, player2);
-    Game* game = new Game(player1, player2);
-    {
-        std::lock_guard<std::mutex> lock(gamesMutex);
-        activeGames[gameId] = game;
-        gamePlayerMap[gameId] = {player1, player2};
-    }
-    std::string msg;
-    msg = "COLOR white\n";
-    send(connectedPlayers[player1], msg.c_str(), msg.length(), 0);
-    msg = "COLOR black\n";
-    send(connectedPlayers[player2], msg.c_str(), msg.length(), 0);
-    msg = "GAME_START\n";
-    send(connectedPlayers[player1], msg.c_str(), msg.length(), 0);
-    send(connectedPlayers[player2], msg.c_str(), msg.length(), 0);
-    msg = "YOUR_TURN\n";
-    send(connectedPlayers[player1], msg.c_str(), msg.length(), 0);
-    msg = "WAIT_TURN\n";
-    send(connectedPlayers[player2], msg.c_str(), msg.length(), 0);
-}
-
-void GameServer::removeGame(const std::string& gameId) {
-    std::lock_guard<std::mutex> lock(gamesMutex);
-    auto gameIt = activeGames.find(gameId);
-    if (gameIt != activeGames.end()) {
-        delete gameIt->second;
-        activeGames.erase(gameId);
-        gamePlayerMap.erase(gameId);
+static void releaseConnection(Connection& conn) {
+    GameHandle expected = PAIRING_GAME;
+    conn.game.compare_exchange_strong(expected, NO_GAME);
+}
+
+// Podpina zajęte połączenie do gry; false, gdy połączenie zamknięto w trakcie jej tworzenia.
+static bool attachConnection(Connection& conn, GameHandle handle) {
+    GameHandle expected = PAIRING_GAME;
+    return conn.game.compare_exchange_strong(expected, handle);
+}
+
+// Wątek kojarzenia: co MATCH_TICK zbiera zgłoszenia z kolejki i dobiera pary całą partią.
+// Gry trafiają do shardów tablicy gier, a komunikaty startowe są wysyłane z tego wątku.
+void GameServer::runMatchmaker() {
+    Matchmaker matchmaker;
+    MatchEvent event;
+    std::vector<std::pair<Matchmaker::Waiting, Matchmaker::Waiting>> pairs;
+    while (true) {
+        std::this_thread::sleep_for(MATCH_TICK);
+        while (matchEvents.pop(event)) matchmaker.apply(event);
+        auto now = std::chrono::steady_clock::now();
+        pairs.clear();
+        matchmaker.pair(now, pairs);
+        for (auto& pair : pairs) {
+            if (startMatchedGame(pair.first, pair.second, matchmaker)) {
+                metricRecord(HIST_MATCH_WAIT, uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(now - pair.first.since).count()));
+                metricRecord(HIST_MATCH_WAIT, uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(now - pair.second.since).count()));
+            }
+        }
+        matchWaiting.store(matchmaker.waitingCount(), std::memory_order_relaxed);
+        flushPendingWrites();
+    }
+}
+
+// Tworzy grę dla dobranej pary. Gracz, którego połączenia nie da się zająć (rozłączył się albo
+// zaczął grę z komputerem), odpada, a drugi wraca do poczekalni.
+bool GameServer::startMatchedGame(Matchmaker::Waiting& white, Matchmaker::Waiting& black, Matchmaker& matchmaker) {
+    bool whiteFree = claimConnection(*white.conn);
+    bool blackFree = claimConnection(*black.conn);
+    if (!whiteFree || !blackFree) {
+        if (whiteFree) {
+            releaseConnection(*white.conn);
+            matchmaker.requeue(std::move(white));
+        }
+        if (blackFree) {
+            releaseConnection(*black.conn);
+            matchmaker.requeue(std::move(black));
+        }
+        return false;
+    }
+    LOG_INFO("Rozpoczynanie gry: %s (%d) vs %s (%d)", white.name.c_str(), white.rating, black.name.c_str(), black.rating);
+    auto session = createGame(white.player, black.player, white.name, black.name);
+    std::lock_guard<std::mutex> sessionLock(session->mutex, std::adopt_lock);
+    session->connections[0] = white.conn;
+    session->connections[1] = black.conn;
+    bool attached[2] = {attachConnection(*white.conn, session->handle), attachConnection(*black.conn, session->handle)};
+    sendToPlayer(*session, 0, MSG_COLOR_WHITE);
+    sendToPlayer(*session, 1, MSG_COLOR_BLACK);
+    sendToPlayer(*session, 0, MSG_GAME_START);
+    sendToPlayer(*session, 1, MSG_GAME_START);
+    OutMessage gameId = makeGameIdMessage(session->handle);
+    sendToPlayer(*session, 0, gameId);
+    sendToPlayer(*session, 1, gameId);
+    sendToPlayer(*session, 0, makeSessionMessage(session->handle, session->secrets[0]));
+    sendToPlayer(*session, 1, makeSessionMessage(session->handle, session->secrets[1]));
+    startClock(*session);
+    sendToPlayer(*session, 0, MSG_YOUR_TURN);
+    sendToPlayer(*session, 1, MSG_WAIT_TURN);
+    for (int i = 0; i < 2; i++) {
+        if (attached[i] || session->finished) continue;
+        // Połączenie zamknięto w trakcie tworzenia gry, więc removePlayer jej nie widział.
+        session->connections[i].reset();
+        abandonGame(*session, i);
+    }
+    return true;
+}
+
+// Wywoływane pod playersMutex.
+PlayerId GameServer::internPlayer(const std::string& name) {
+    auto it = playerIds.find(name);
+    if (it != playerIds.end()) return it->second;
+    PlayerId id = PlayerId(players.size());
+    players.push_back({name, nullptr});
+    playerIds.emplace(name, id);
+    return id;
+}
+
+// Zapisuje w dzienniku koniec gry, raz na sesję; wołający trzyma session.mutex.
+void GameServer::journalEnd(GameSession& session) {
+    if (session.journalId == 0) return;
+    journal.logEnd(session.journalId);
+    session.journalId = 0;
+}
+
+void GameServer::removeGame(GameHandle handle) {
+    auto session = games.remove(handle);
+    if (session) {
+        MeasuredLock lock(session->mutex, HIST_WAIT_SESSION, COUNTER_LOCK_SESSION);
+        session->finished = true;
     }
 }
 
 void GameServer::setupServer(int port) {
+    // Każde połączenie to deskryptor; podnosimy miękki limit do twardego.
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
     serverSocket = socket(AF_INET, SOCK_STREAM, 0);
     if (serverSocket < 0) {
         perror("Tworzenie gniazda nie powiodło się");
@@ -515,266 +1345,930 @@ void GameServer::setupServer(int port) {
         perror("Powiązanie nie powiodło się");
         exit(1);
     }
-    if (listen(serverSocket, 10) < 0) {
+    if (listen(serverSocket, SOMAXCONN) < 0) {
         perror("Nasłuchiwanie nie powiodło się");
         exit(1);
     }
-    std::cout << "Serwer uruchomiony na porcie " << port << std::endl;
+    LOG_INFO("Serwer uruchomiony na porcie %d", port);
+}
+
+void GameServer::sendToConnection(const std::shared_ptr<Connection>& conn, const OutMessage& message) {
+    queueMessage(conn, conn->binary.load(std::memory_order_relaxed) ? message.binary : message.text);
+    LOG_DEBUG("Wysłano do %s: %.*s", conn->displayName(), int(message.text->size()) - 1, message.text->data());
 }
 
-void GameServer::sendMessage(const std::string& player, const std::string& message) {
-    std::lock_guard<std::mutex> lock(playersMutex);
-    auto it = connectedPlayers.find(player);
-    if (it != connectedPlayers.end()) {
-        int clientSocket = it->second;
-        std::string msg = message + "\n";
-        send(clientSocket, msg.c_str(), msg.length(), 0);
-        std::cout << "Wysłano do " << player << ": " << message << std::endl;
+// Wysyła komunikat graczowi sesji bez globalnych blokad; wołający trzyma session.mutex.
+void GameServer::sendToPlayer(GameSession& session, int index, const OutMessage& message) {
+    if (session.connections[index]) {
+        sendToConnection(session.connections[index], message);
     }
 }
 
-void GameServer::removePlayer(const std::string& playerName) {
-    if (playerName.empty()) return;
+void GameServer::removePlayer(const std::shared_ptr<Connection>& conn) {
+    if (conn->playerId == NO_PLAYER) return;
+    metricCount(COUNTER_PLAYERS_LEFT);
     
     {
-        std::lock_guard<std::mutex> playersLock(playersMutex);
-        connectedPlayers.erase(playerName);
-        std::cout << "Usunięto gracza: " << playerName << std::endl;
+        MeasuredLock playersLock(playersMutex, HIST_WAIT_PLAYERS, COUNTER_LOCK_PLAYERS);
+        PlayerEntry& entry = players[conn->playerId];
+        if (entry.connection == conn) {
+            entry.connection.reset();
+        }
+        LOG_INFO("Usunięto gracza: %s", conn->displayName());
     }
+    // Rozłączony gracz nie może zostać sparowany; przy pełnej kolejce wpis odpadnie przy
+    // próbie zajęcia zamkniętego połączenia.
+    MatchEvent leave;
+    leave.type = MatchEvent::LEAVE;
+    leave.conn = conn;
+    matchEvents.push(std::move(leave));
     
-    {
-        std::lock_guard<std::mutex> gamesLock(gamesMutex);
-        // Pobieramy gameId dla rozłączającego się gracza
-        auto it = playerToGameId.find(playerName);
-        if (it != playerToGameId.end()) {
-            std::string gameId = it->second;
-            // Pobieramy listę graczy tej gry
-            if (gamePlayerMap.find(gameId) != gamePlayerMap.end()) {
-                auto players = gamePlayerMap[gameId];
-                std::string opponent;
-                for (const auto& p : players) {
-                    if (p != playerName) {
-                        opponent = p;
-                        break;
-                    }
-                }
-                if (!opponent.empty()) {
-                    sendMessage(opponent, "OPPONENT_DISCONNECTED");
-                }
-                // Usuwamy mapowanie gry dla obu graczy
-                for (const auto& p : players) {
-                    playerToGameId.erase(p);
-                }
-                gamePlayerMap.erase(gameId);
-            }
-            if (activeGames.find(gameId) != activeGames.end()) {
-                delete activeGames[gameId];
-                activeGames.erase(gameId);
-            }
-        }
+    auto session = games.get(conn->game.exchange(NO_GAME));
+    if (!session) return;
+    MeasuredLock lock(session->mutex, HIST_WAIT_SESSION, COUNTER_LOCK_SESSION);
+    if (session->finished) return;
+    int me = (session->players[0] == conn->playerId) ? 0 : 1;
+    // W trwającej grze zerwane połączenie nie kończy gry: gracz ma czas na RESUME.
+    if (gracePeriod.count() > 0 && session->connections[me] == conn && gameResult(*session->game).empty()) {
+        session->connections[me].reset();
+        startGrace(*session, me);
+        sendToPlayer(*session, 1 - me, MSG_OPPONENT_AWAY);
+        broadcastToWatchers(*session, MSG_OPPONENT_AWAY);
+        return;
     }
+    abandonGame(*session, me);
 }
 
 
-void GameServer::processCommand(const std::string& cmd, int clientSocket, std::string& playerName) {
-   std::istringstream ss(cmd);
-   std::string command;
-   ss >> command;
-   std::cout << "\nOtrzymano komendę: " << cmd << std::endl;
+void GameServer::processCommand(std::string_view cmd, const std::shared_ptr<Connection>& conn) {
+   std::string& playerName = conn->playerName;
+   std::string_view rest = cmd;
+   std::string_view command = nextToken(rest);
+   LOG_DEBUG("Otrzymano komendę: %.*s", int(cmd.size()), cmd.data());
+   MetricCommand kind = command == "MOVE" ? COMMAND_MOVE
+                      : command == "CONNECT" ? COMMAND_CONNECT
+                      : command == "BOARD" ? COMMAND_BOARD
+                      : command == "PLAY_BOT" ? COMMAND_PLAY_BOT
+                      : command == "STATS" ? COMMAND_STATS
+                      : command == "WATCH" ? COMMAND_WATCH
+                      : command == "RESUME" ? COMMAND_RESUME
+                      : command == "BOOK" ? COMMAND_BOOK : COMMAND_UNKNOWN;
+   ScopedTimer timer(MetricHistogram(HIST_COMMAND_CONNECT + kind));
    if (command == "CONNECT") {
-        ss >> playerName;
+        std::string_view name = nextToken(rest);
+        if (name.empty()) return;
+        // Dziennik zapisuje najwyżej JOURNAL_MAX_NAME bajtów nazwy; dłuższa po odtworzeniu gry
+        // nie pasowałaby do żadnego gracza.
+        if (name.size() > JOURNAL_MAX_NAME) {
+            LOG_WARN("Nazwa gracza za długa (%zu bajtów, limit %zu), CONNECT pominięty", name.size(),
+                     JOURNAL_MAX_NAME);
+            return;
+        }
+        bool binary = (nextToken(rest) == "BINARY");
+        // Nazwa i tryb są ustalane raz; kolejny CONNECT tylko wraca do kojarzenia pod tą samą
+        // nazwą. Zmiana trybu pomieszałaby formaty komunikatów czekających już w kolejce.
+        if (conn->named.load(std::memory_order_relaxed)) {
+            if (name != playerName || binary != conn->binary.load(std::memory_order_relaxed)) {
+                LOG_WARN("Gracz %s próbuje zmienić nazwę lub tryb (%.*s%s), CONNECT pominięty", playerName.c_str(),
+                         int(name.size()), name.data(), binary ? " BINARY" : "");
+                return;
+            }
+        } else {
+            // Tryb wybieramy przed publikacją połączenia w tablicy graczy.
+            conn->binary.store(binary, std::memory_order_relaxed);
+            conn->setName(name);
+        }
+        std::shared_ptr<GameSession> recovered;
         {
-            std::lock_guard<std::mutex> lock(playersMutex);
-            connectedPlayers[playerName] = clientSocket;
-            std::cout << "Gracz połączony: " << playerName << std::endl;
-            waitingPlayers.push(playerName);
-            if (waitingPlayers.size() >= 2) {
-                std::string player1 = waitingPlayers.front(); waitingPlayers.pop();
-                std::string player2 = waitingPlayers.front(); waitingPlayers.pop();
-                std::string gameId = player1 + "_vs_" + player2;
-                std::cout << "Rozpoczynanie gry: " << player1 << " vs " << player2 << std::endl;
-                Game* game = new Game(player1, player2);
-                {
-                    std::lock_guard<std::mutex> gamesLock(gamesMutex);
-                    activeGames[gameId] = game;
-                    gamePlayerMap[gameId] = {player1, player2};
-                    playerToGameId[player1] = gameId;
-                    playerToGameId[player2] = gameId;
+            MeasuredLock lock(playersMutex, HIST_WAIT_PLAYERS, COUNTER_LOCK_PLAYERS);
+            if (conn->playerId == NO_PLAYER) metricCount(COUNTER_PLAYERS_JOINED);
+            conn->playerId = internPlayer(playerName);
+            players[conn->playerId].connection = conn;
+            LOG_INFO("Gracz połączony: %s", playerName.c_str());
+            auto it = recoveredGames.find(conn->playerId);
+            if (it != recoveredGames.end()) {
+                recovered = games.get(it->second);
+                recoveredGames.erase(it);
+            }
+        }
+        if (recovered) {
+            resumeGame(conn, recovered);
+            return;
+        }
+        // Gracz w trwającej grze nie wraca do poczekalni; po końcu gry może szukać kolejnej.
+        GameHandle current = conn->game.load();
+        if (current == PAIRING_GAME) return;
+        if (current != NO_GAME) {
+            if (auto session = games.get(current)) {
+                MeasuredLock lock(session->mutex, HIST_WAIT_SESSION, COUNTER_LOCK_SESSION);
+                if (!session->finished && gameResult(*session->game).empty()) {
+                    LOG_WARN("Gracz %s już jest w grze, CONNECT nie szuka nowej", playerName.c_str());
+                    return;
                 }
-                std::string msg;
-                msg = "COLOR white\n";
-                send(connectedPlayers[player1], msg.c_str(), msg.length(), 0);
-                std::cout << "Wysłano do " << player1 << ": COLOR white" << std::endl;
-                msg = "COLOR black\n";
-                send(connectedPlayers[player2], msg.c_str(), msg.length(), 0);
-                std::cout << "Wysłano do " << player2 << ": COLOR black" << std::endl;
-                msg = "GAME_START\n";
-                send(connectedPlayers[player1], msg.c_str(), msg.length(), 0);
-                send(connectedPlayers[player2], msg.c_str(), msg.length(), 0);
-                std::cout << "Wysłano GAME_START do obu graczy" << std::endl;
-                msg = "YOUR_TURN\n";
-                send(connectedPlayers[player1], msg.c_str(), msg.length(), 0);
-                std::cout << "Wysłano YOUR_TURN do " << player1 << std::endl;
-                msg = "WAIT_TURN\n";
-                send(connectedPlayers[player2], msg.c_str(), msg.length(), 0);
-                std::cout << "Wysłano WAIT_TURN do " << player2 << std::endl;
-                std::cout << "Wszystkie wiadomości inicjalizacyjne zostały wysłane" << std::endl;
             }
+            conn->game.compare_exchange_strong(current, NO_GAME);
+        }
+        // Parę dobiera wątek kojarzenia; tutaj nic nie czeka na innych graczy.
+        MatchEvent join;
+        join.type = MatchEvent::JOIN;
+        join.conn = conn;
+        join.player = conn->playerId;
+        join.name = playerName;
+        join.since = std::chrono::steady_clock::now();
+        if (!matchEvents.push(std::move(join))) {
+            LOG_WARN("Kolejka kojarzenia pełna, gracz %s odrzucony", playerName.c_str());
+            sendToConnection(conn, MSG_SERVER_BUSY);
         }
    }
    else if (command == "MOVE") {
         int fromX, fromY, toX, toY;
-        ss >> fromX >> fromY >> toX >> toY;
-        std::cout << "Próba ruchu: " << playerName << " (" << fromX << "," << fromY << ") -> (" << toX << "," << toY << ")" << std::endl;
-        std::lock_guard<std::mutex> lock(gamesMutex);
-        auto gameIdIt = playerToGameId.find(playerName);
-        if (gameIdIt == playerToGameId.end()) {
-            std::cout << "Błąd: Gracz " << playerName << " nie ma przypisanej gry!" << std::endl;
-            sendMessage(playerName, "NO_GAME_FOUND");
+        if (!parseInt(nextToken(rest), fromX) || !parseInt(nextToken(rest), fromY) ||
+            !parseInt(nextToken(rest), toX) || !parseInt(nextToken(rest), toY)) {
+            LOG_DEBUG("Błąd: Niepoprawny format komendy MOVE");
+            sendToConnection(conn, MSG_INVALID_MOVE);
             return;
         }
-        std::string gameId = gameIdIt->second;
-        auto gameIt = activeGames.find(gameId);
-        if (gameIt != activeGames.end()) {
-            Game* game = gameIt->second;
-            bool isWhite = (playerName == game->getPlayer1());
-            std::cout << "isWhite: " << isWhite << ", currentPlayer: " << game->getCurrentPlayer() << std::endl;
-            auto allCaptures = game->getAllAvailableCaptures(isWhite);
-            if (game->getCurrentPlayer() == (isWhite ? 1 : 2)) {
-                if (!allCaptures.empty()) {
-                    auto currentCaptures = game->getAvailableCaptures(fromX, fromY, isWhite);
-                    if (currentCaptures.empty()) {
-                        std::cout << "Musisz wykonać bicie innym pionkiem!" << std::endl;
-                        sendMessage(playerName, "INVALID_MOVE");
-                        return;
-                    }
-                }
-                if (game->isValidMove(fromX, fromY, toX, toY, isWhite)) {
-                    std::cout << "Ruch wykonany przez " << playerName << ": " 
-                            << fromX << "," << fromY << " -> " << toX << "," << toY << std::endl;
-                    
-                    bool isCapture = abs(toX - fromX) > 1;
-                    std::string moveUpdate;
-                    int capturedX, capturedY;
-                    bool promotion = false;  // nowa zmienna do sprawdzenia promocji
-                    
-                    if (isCapture) {
-                        // Pobieramy typ pionka przed wykonaniem ruchu
-                        int piece = game->getPieceAt(fromX, fromY);
-                        if (piece == Game::WHITE_KING || piece == Game::BLACK_KING) {
-                            std::pair<int, int> captured = game->getCapturedCoordinatesForKing(fromX, fromY, toX, toY);
-                            capturedX = captured.first;
-                            capturedY = captured.second;
-                        } else {
-                            // Dla zwykłego pionka używamy standardowego wzoru
-                            capturedX = (fromX + toX) / 2;
-                            capturedY = (fromY + toY) / 2;
-                            // Sprawdzamy, czy nastąpi promocja (dla białych linia promocji to 0, dla czarnych to BOARD_SIZE - 1)
-                            if ((isWhite && toX == 0) || (!isWhite && toX == Game::BOARD_SIZE - 1)) {
-                                promotion = true;
-                            }
-                        }
-                        
-                        game->makeMove(fromX, fromY, toX, toY, playerName);
-                        
-                        moveUpdate = "MOVE_UPDATE " + std::to_string(fromX) + " " + 
-                                    std::to_string(fromY) + " " + std::to_string(toX) + " " + 
-                                    std::to_string(toY) + " CAPTURE " + std::to_string(capturedX) + " " + 
-                                    std::to_string(capturedY);
-                        if (game->isKingAt(toX, toY)) {
-                            moveUpdate += " KING";
-                        }
-                        
-                        sendMessage(playerName, moveUpdate);
-                        sendMessage(game->getOpponent(playerName), moveUpdate);
-                        
-                        // Sprawdzenie, czy są kolejne możliwe bicia z pola docelowego
-                        auto nextCaptures = game->getAvailableCaptures(toX, toY, isWhite);
-                        // Jeśli nastąpiła promocja lub nie ma kolejnych bić – kończymy turę
-                        if (promotion || nextCaptures.empty()) {
-                            game->setCurrentPlayer(isWhite ? 2 : 1);
-                            sendMessage(playerName, "WAIT_TURN");
-                            sendMessage(game->getOpponent(playerName), "YOUR_TURN");
-                        } else {
-                            sendMessage(playerName, "YOUR_TURN");
-                            sendMessage(game->getOpponent(playerName), "WAIT_TURN");
-                        }
-                    } else {
-                        // Ruch bez bicia
-                        game->makeMove(fromX, fromY, toX, toY, playerName);
-                        
-                        moveUpdate = "MOVE_UPDATE " + std::to_string(fromX) + " " + 
-                                    std::to_string(fromY) + " " + std::to_string(toX) + " " + 
-                                    std::to_string(toY);
-                        if (game->isKingAt(toX, toY)) {
-                            moveUpdate += " KING";
-                        }
-                        
-                        sendMessage(playerName, moveUpdate);
-                        sendMessage(game->getOpponent(playerName), moveUpdate);
-                        
-                        game->setCurrentPlayer(isWhite ? 2 : 1);
-                        sendMessage(playerName, "WAIT_TURN");
-                        sendMessage(game->getOpponent(playerName), "YOUR_TURN");
-                    }
-                } else {
-                    std::cout << "Nieprawidłowy ruch!" << std::endl;
-                    sendMessage(playerName, "INVALID_MOVE");
-                }
+        handleMove(conn, fromX, fromY, toX, toY);
+   }
+   else if (command == "BOARD") {
+        handleBoardRequest(conn);
+   }
+   else if (command == "BOOK") {
+        handleBookRequest(conn);
+   }
+   else if (command == "PLAY_BOT") {
+        int level;
+        if (!parseInt(nextToken(rest), level)) {
+            LOG_DEBUG("Błąd: Niepoprawny format komendy PLAY_BOT");
+            sendToConnection(conn, MSG_INVALID_MOVE);
+            return;
+        }
+        handlePlayBot(conn, level);
+   }
+   else if (command == "STATS") {
+        handleStats(conn);
+   }
+   else if (command == "WATCH") {
+        std::string_view token = nextToken(rest);
+        uint64_t gameId;
+        auto result = std::from_chars(token.data(), token.data() + token.size(), gameId);
+        if (result.ec != std::errc() || result.ptr != token.data() + token.size()) {
+            LOG_DEBUG("Błąd: Niepoprawny format komendy WATCH");
+            sendToConnection(conn, MSG_NO_GAME_FOUND);
+            return;
+        }
+        handleWatch(conn, gameId);
+   }
+   else if (command == "RESUME") {
+        uint64_t gameId, secret;
+        uint32_t seenHops;
+        std::string_view tokens[3] = {nextToken(rest), nextToken(rest), nextToken(rest)};
+        if (std::from_chars(tokens[0].data(), tokens[0].data() + tokens[0].size(), gameId).ec != std::errc() ||
+            std::from_chars(tokens[1].data(), tokens[1].data() + tokens[1].size(), secret).ec != std::errc() ||
+            std::from_chars(tokens[2].data(), tokens[2].data() + tokens[2].size(), seenHops).ec != std::errc()) {
+            LOG_DEBUG("Błąd: Niepoprawny format komendy RESUME");
+            sendToConnection(conn, MSG_NO_GAME_FOUND);
+            return;
+        }
+        // Jak przy CONNECT: tryb ustalamy przed podpięciem połączenia do gry.
+        if (conn->playerId == NO_PLAYER) conn->binary.store(nextToken(rest) == "BINARY", std::memory_order_relaxed);
+        handleResume(conn, gameId, secret, seenHops);
+   }
+}
 
-                if (game->checkGameEnd()) {
-                    std::string winner;
-                    if (game->getWhiteCount() == 0)
-                        winner = "black";
-                    else if (game->getBlackCount() == 0)
-                        winner = "white";
-                    sendMessage(playerName, "GAME_OVER " + winner);
-                    sendMessage(game->getOpponent(playerName), "GAME_OVER " + winner);
-                    return;
-                }
+void GameServer::processBinaryFrame(uint8_t type, std::string_view payload, const std::shared_ptr<Connection>& conn) {
+    MetricCommand kind = type == BIN_MOVE ? COMMAND_MOVE
+                       : type == BIN_BOARD_REQUEST ? COMMAND_BOARD
+                       : type == BIN_PLAY_BOT ? COMMAND_PLAY_BOT
+                       : type == BIN_WATCH ? COMMAND_WATCH : COMMAND_UNKNOWN;
+    ScopedTimer timer(MetricHistogram(HIST_COMMAND_CONNECT + kind));
+    if (type == BIN_MOVE) {
+        if (payload.size() != 2 || uint8_t(payload[0]) >= 32 || uint8_t(payload[1]) >= 32) {
+            LOG_DEBUG("Błąd: Niepoprawna ramka MOVE");
+            sendToConnection(conn, MSG_INVALID_MOVE);
+            return;
+        }
+        int fromSq = uint8_t(payload[0]), toSq = uint8_t(payload[1]);
+        handleMove(conn, squareRow(fromSq), squareCol(fromSq), squareRow(toSq), squareCol(toSq));
+    } else if (type == BIN_BOARD_REQUEST) {
+        handleBoardRequest(conn);
+    } else if (type == BIN_PLAY_BOT && payload.size() == 1) {
+        handlePlayBot(conn, uint8_t(payload[0]));
+    } else if (type == BIN_WATCH && payload.size() == 8) {
+        uint64_t gameId = 0;
+        for (int i = 0; i < 8; i++) gameId |= uint64_t(uint8_t(payload[i])) << (8 * i);
+        handleWatch(conn, gameId);
+    } else {
+        LOG_DEBUG("Nieznany typ ramki binarnej: %d", type);
+    }
+}
+
+void GameServer::handleBoardRequest(const std::shared_ptr<Connection>& conn) {
+    auto session = games.get(conn->game.load());
+    if (!session) {
+        sendToConnection(conn, MSG_NO_GAME_FOUND);
+        return;
+    }
+    MeasuredLock lock(session->mutex, HIST_WAIT_SESSION, COUNTER_LOCK_SESSION);
+    if (!session->finished) {
+        sendToConnection(conn, makeBoardMessage(*session->game));
+    }
+}
+
+// BOOK (tylko tekstowo, jak STATS): statystyki księgi dla bieżącej pozycji gry gracza albo
+// obserwowanej gry. Wiersz "BOOK partie białe remisy czarne", po nim "BOOK_MOVE partie białe
+// remisy czarne x y x y..." dla każdego ruchu z księgi (pola kolejnych skoków) i BOOK_END.
+void GameServer::handleBookRequest(const std::shared_ptr<Connection>& conn) {
+    auto session = games.get(conn->game.load());
+    if (!session) session = games.get(conn->watching.load());
+    if (!session) {
+        sendToConnection(conn, MSG_NO_GAME_FOUND);
+        return;
+    }
+    Board board;
+    bool whiteToMove;
+    bool chainPending;
+    {
+        MeasuredLock lock(session->mutex, HIST_WAIT_SESSION, COUNTER_LOCK_SESSION);
+        if (session->finished) {
+            sendToConnection(conn, MSG_NO_GAME_FOUND);
+            return;
+        }
+        board = session->game->getBoard();
+        whiteToMove = session->game->getCurrentPlayer() == 1;
+        chainPending = session->game->isCaptureChainPending();
+    }
+    // Odczyt księgi nie wymaga blokady sesji: plik jest tylko do odczytu.
+    std::string out;
+    char line[256];
+    const BookEntry* position = book.find(positionKey(board, whiteToMove));
+    BookEntry stats = position ? *position : BookEntry{0, 0, 0, 0, 0};
+    snprintf(line, sizeof(line), "BOOK %u %u %u %u\n", stats.games, stats.whiteWins, stats.draws(), stats.blackWins);
+    out += line;
+    BookMove moves[MAX_MOVES];
+    int count = chainPending ? 0 : book.bookMoves(board, whiteToMove, moves, MAX_MOVES);
+    for (int i = 0; i < count; i++) {
+        const BookEntry& move = moves[i].stats;
+        int length = snprintf(line, sizeof(line), "BOOK_MOVE %u %u %u %u %d %d", move.games, move.whiteWins,
+                              move.draws(), move.blackWins, squareRow(moves[i].move.from), squareCol(moves[i].move.from));
+        out.append(line, length);
+        for (int hop = 0; hop < moves[i].move.hops; hop++) {
+            int square = moves[i].move.path[hop];
+            length = snprintf(line, sizeof(line), " %d %d", squareRow(square), squareCol(square));
+            out.append(line, length);
+        }
+        out += '\n';
+    }
+    out += "BOOK_END\n";
+    queueMessage(conn, std::make_shared<const std::string>(std::move(out)));
+}
+
+void GameServer::handleMove(const std::shared_ptr<Connection>& conn, int fromX, int fromY, int toX, int toY) {
+    const std::string& playerName = conn->playerName;
+    LOG_DEBUG("Próba ruchu: %s (%d,%d) -> (%d,%d)", playerName.c_str(), fromX, fromY, toX, toY);
+    auto session = games.get(conn->game.load());
+    if (!session) {
+        LOG_WARN("Błąd: Gracz %s nie ma przypisanej gry!", playerName.c_str());
+        sendToConnection(conn, MSG_NO_GAME_FOUND);
+        return;
+    }
+    // Blokujemy tylko tę grę; wysyłanie nie czeka na inne gry ani na globalne mapy.
+    MeasuredLock lock(session->mutex, HIST_WAIT_SESSION, COUNTER_LOCK_SESSION);
+    if (session->finished) return;
+    Game* game = session->game;
+    bool isWhite = (conn->playerId == game->getPlayer1());
+    int me = isWhite ? 0 : 1;
+    LOG_DEBUG("isWhite: %d, currentPlayer: %d", isWhite, game->getCurrentPlayer());
+    if (game->getCurrentPlayer() != (isWhite ? 1 : 2)) {
+        LOG_DEBUG("Nie twoja kolej!");
+        sendToPlayer(*session, me, MSG_NOT_YOUR_TURN);
+        return;
+    }
+    // Timer zegara działa z dokładnością do tiku; ruch po terminie też przegrywa na czas.
+    if (clockExpired(*session, me)) {
+        flagFall(*session, me);
+        return;
+    }
+    bool valid;
+    {
+        ScopedTimer timer(HIST_MOVE_VALIDATION);
+        valid = game->isValidMove(fromX, fromY, toX, toY, isWhite);
+    }
+    if (valid) {
+        LOG_DEBUG("Ruch wykonany przez %s: %d,%d -> %d,%d", playerName.c_str(), fromX, fromY, toX, toY);
+        playHop(*session, me, fromX, fromY, toX, toY);
+    } else {
+        LOG_DEBUG("Nieprawidłowy ruch!");
+        metricCount(COUNTER_INVALID_MOVES);
+        sendToPlayer(*session, me, MSG_INVALID_MOVE);
+    }
+
+    if (!finishIfOver(*session)) {
+        scheduleBotMove(session);
+    }
+}
+
+// Wykonuje zweryfikowany skok gracza o indeksie me i rozsyła wynik; wołający trzyma session.mutex.
+void GameServer::playHop(GameSession& session, int me, int fromX, int fromY, int toX, int toY) {
+    Game* game = session.game;
+    int opponent = 1 - me;
+    HopRecord hop = applyHop(session, me, fromX, fromY, toX, toY);
+    if (session.journalId != 0) journal.logHop(session.journalId, hop.from, hop.to);
 
-            } else {
-                std::cout << "Nie twoja kolej!" << std::endl;
-                sendMessage(playerName, "NOT_YOUR_TURN");
+    // Ten sam bufor trafia do obu graczy.
+    OutMessage update = makeMoveUpdate(hop);
+    sendToPlayer(session, me, update);
+    sendToPlayer(session, opponent, update);
+    broadcastToWatchers(session, update);
+
+    // Jeśli nastąpiła promocja lub nie ma kolejnych bić – kończymy turę
+    if (!game->isCaptureChainPending()) {
+        game->setCurrentPlayer(me == 0 ? 2 : 1);
+        switchClock(session, me);
+        sendToPlayer(session, me, MSG_WAIT_TURN);
+        sendToPlayer(session, opponent, MSG_YOUR_TURN);
+    } else {
+        sendToPlayer(session, me, MSG_YOUR_TURN);
+        sendToPlayer(session, opponent, MSG_WAIT_TURN);
+    }
+}
+
+// Wysyła GAME_OVER, jeśli gra się zakończyła, i zwalnia jej slot jak flagFall; wołający trzyma
+// session.mutex. Gracze, którzy potem wysyłają CONNECT, nie trzymają już odwołań do sesji.
+bool GameServer::finishIfOver(GameSession& session) {
+    Game* game = session.game;
+    // Remisu z bazy końcówek nie trzeba dogrywać do trzykrotnego powtórzenia.
+    if (tablebase.loaded() && !game->isDraw() && !game->isCaptureChainPending() &&
+        tablebase.probe(game->getBoard(), game->getCurrentPlayer() == 1).result == TB_DRAW) {
+        LOG_INFO("Pozycja remisowa według bazy końcówek");
+        game->declareDraw();
+        metricCount(COUNTER_TABLEBASE_DRAWS);
+    }
+    if (!game->checkGameEnd()) return false;
+    OutMessage gameOver = makeGameOver(gameResult(*game));
+    sendToPlayer(session, 0, gameOver);
+    sendToPlayer(session, 1, gameOver);
+    broadcastToWatchers(session, gameOver);
+    std::string result = gameResult(*game);
+    reportResult(session, result == "white" ? 2 : result == "draw" ? 1 : 0);
+    endSession(session);
+    LOG_INFO("Koniec gry; pula gier: zajęte %zu z %zu", gamePool.inUse(), gamePool.capacity());
+    return true;
+}
+
+void GameServer::handlePlayBot(const std::shared_ptr<Connection>& conn, int level) {
+    if (conn->playerId == NO_PLAYER) {
+        LOG_WARN("PLAY_BOT przed CONNECT, komenda pominięta");
+        return;
+    }
+    level = std::min(std::max(level, 1), BOT_LEVEL_COUNT);
+    // Zajęte połączenie nie trafi już do pary u kojarzenia, nawet jeśli czeka w poczekalni.
+    if (!claimConnection(*conn)) {
+        LOG_WARN("Gracz %s już jest w grze, PLAY_BOT pominięte", conn->playerName.c_str());
+        return;
+    }
+    std::shared_ptr<GameSession> session;
+    {
+        MeasuredLock lock(playersMutex, HIST_WAIT_PLAYERS, COUNTER_LOCK_PLAYERS);
+        std::string botName = "komputer poziom " + std::to_string(level);
+        LOG_INFO("Rozpoczynanie gry z komputerem: %s vs poziom %d", conn->playerName.c_str(), level);
+        session = createGame(conn->playerId, BOT_PLAYER, conn->playerName, botName, level);
+    }
+    // Człowiek gra białymi i zaczyna, więc komputer rusza dopiero po jego pierwszym ruchu.
+    std::lock_guard<std::mutex> sessionLock(session->mutex, std::adopt_lock);
+    session->connections[0] = conn;
+    if (!attachConnection(*conn, session->handle)) {
+        session->connections[0].reset();
+        abandonGame(*session, 0);
+        return;
+    }
+    sendToPlayer(*session, 0, MSG_COLOR_WHITE);
+    sendToPlayer(*session, 0, MSG_GAME_START);
+    sendToPlayer(*session, 0, makeGameIdMessage(session->handle));
+    sendToPlayer(*session, 0, makeSessionMessage(session->handle, session->secrets[0]));
+    startClock(*session);
+    sendToPlayer(*session, 0, MSG_YOUR_TURN);
+}
+
+// Dopisuje obserwatora do gry i wysyła mu stan planszy. Kolejne ruchy dojdą przez
+// broadcastToWatchers; lista jest podmieniana pod blokadą sesji, więc obserwator dostaje
+// każdy ruch wykonany po migawce i żadnego sprzed niej.
+void GameServer::handleWatch(const std::shared_ptr<Connection>& conn, uint64_t gameId) {
+    auto session = games.get(gameId);
+    if (!session) {
+        sendToConnection(conn, MSG_NO_GAME_FOUND);
+        return;
+    }
+    stopWatching(conn);
+    MeasuredLock lock(session->mutex, HIST_WAIT_SESSION, COUNTER_LOCK_SESSION);
+    if (session->finished) {
+        sendToConnection(conn, MSG_NO_GAME_FOUND);
+        return;
+    }
+    // Nowy obserwator trafi do opublikowanej listy przy najbliższym ruchu, przed jego rozesłaniem.
+    session->watcherJoins.push_back({conn, conn->watchEpoch.fetch_add(1) + 1});
+    conn->watching.store(gameId);
+    metricCount(COUNTER_WATCHERS_JOINED);
+    LOG_DEBUG("Nowy obserwator gry %llu", (unsigned long long)gameId);
+    sendToConnection(conn, makeBoardMessage(*session->game));
+    std::string result = gameResult(*session->game);
+    if (!result.empty()) sendToConnection(conn, makeGameOver(result));
+    else if (clockBase.count() > 0) sendToConnection(conn, clockMessage(*session));
+}
+
+void GameServer::stopWatching(const std::shared_ptr<Connection>& conn) {
+    GameHandle handle = conn->watching.exchange(NO_GAME);
+    if (handle == NO_GAME) return;
+    // Od tej chwili wpis obserwatora jest pomijany przy rozsyłaniu; listę czyści publishWatchers.
+    conn->watchEpoch.fetch_add(1);
+    metricCount(COUNTER_WATCHERS_LEFT);
+    auto session = games.get(handle);
+    if (!session) return;
+    MeasuredLock lock(session->mutex, HIST_WAIT_SESSION, COUNTER_LOCK_SESSION);
+    size_t entries = (session->watchers ? session->watchers->size() : 0) + session->watcherJoins.size();
+    if (++session->staleWatchers * 2 > entries) publishWatchers(*session);
+}
+
+static void appendSummary(std::string& out, const char* prefix, MetricHistogram histogram) {
+    HistogramSummary h = Metrics::instance().summarize(histogram);
+    char line[256];
+    snprintf(line, sizeof(line), "%s count %llu p50_us %.3f p99_us %.3f p999_us %.3f max_us %.3f total_ms %.3f\n",
+             prefix, (unsigned long long)h.count, h.p50 / 1e3, h.p99 / 1e3, h.p999 / 1e3, h.max / 1e3,
+             h.totalNanos / 1e6);
+    out += line;
+}
+
+// Odpowiedź na STATS: wiersze "STATS <nazwa> <klucz> <wartość>..." zakończone "STATS_END".
+// Dostępne tylko w trybie tekstowym; działa także przed CONNECT, np. dla skryptów monitorujących.
+void GameServer::handleStats(const std::shared_ptr<Connection>& conn) {
+    Metrics& metrics = Metrics::instance();
+    size_t waiting = matchWaiting.load(std::memory_order_relaxed);
+    uint64_t accepted = metrics.counter(COUNTER_CONNECTIONS_ACCEPTED);
+    uint64_t closed = metrics.counter(COUNTER_CONNECTIONS_CLOSED);
+    uint64_t joined = metrics.counter(COUNTER_PLAYERS_JOINED);
+    uint64_t left = metrics.counter(COUNTER_PLAYERS_LEFT);
+    double uptime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    std::string out;
+    char line[256];
+    snprintf(line, sizeof(line), "STATS uptime_s %.1f\n", uptime);
+    out += line;
+    snprintf(line, sizeof(line), "STATS connections open %llu accepted %llu closed %llu\n",
+             (unsigned long long)(accepted - closed), (unsigned long long)accepted, (unsigned long long)closed);
+    out += line;
+    snprintf(line, sizeof(line), "STATS players connected %llu waiting %zu\n", (unsigned long long)(joined - left), waiting);
+    out += line;
+    snprintf(line, sizeof(line), "STATS games active %zu pool_capacity %zu\n", gamePool.inUse(), gamePool.capacity());
+    out += line;
+    uint64_t watchersJoined = metrics.counter(COUNTER_WATCHERS_JOINED);
+    snprintf(line, sizeof(line), "STATS watchers active %llu dropped %llu\n",
+             (unsigned long long)(watchersJoined - metrics.counter(COUNTER_WATCHERS_LEFT)),
+             (unsigned long long)metrics.counter(COUNTER_WATCHERS_DROPPED));
+    out += line;
+    snprintf(line, sizeof(line), "STATS moves invalid %llu\nSTATS send bytes %llu\n",
+             (unsigned long long)metrics.counter(COUNTER_INVALID_MOVES),
+             (unsigned long long)metrics.counter(COUNTER_BYTES_SENT));
+    out += line;
+    snprintf(line, sizeof(line), "STATS resume delta %llu snapshot %llu grace_expired %llu\n",
+             (unsigned long long)metrics.counter(COUNTER_RESUMES_DELTA),
+             (unsigned long long)metrics.counter(COUNTER_RESUMES_SNAPSHOT),
+             (unsigned long long)metrics.counter(COUNTER_GRACE_EXPIRED));
+    out += line;
+    snprintf(line, sizeof(line), "STATS journal records %llu batches %llu stalls %llu\n",
+             (unsigned long long)metrics.counter(COUNTER_JOURNAL_RECORDS),
+             (unsigned long long)metrics.counter(COUNTER_JOURNAL_BATCHES),
+             (unsigned long long)metrics.counter(COUNTER_JOURNAL_STALLS));
+    out += line;
+    snprintf(line, sizeof(line), "STATS timers active %zu flag_falls %llu idle_closed %llu\n", timers.size(),
+             (unsigned long long)metrics.counter(COUNTER_FLAG_FALLS),
+             (unsigned long long)metrics.counter(COUNTER_IDLE_CLOSED));
+    out += line;
+    snprintf(line, sizeof(line), "STATS tablebase pieces %d bot_moves %llu adjudicated_draws %llu\n", tablebase.pieces(),
+             (unsigned long long)metrics.counter(COUNTER_TABLEBASE_MOVES),
+             (unsigned long long)metrics.counter(COUNTER_TABLEBASE_DRAWS));
+    out += line;
+    snprintf(line, sizeof(line), "STATS book positions %zu bot_moves %llu\n", book.size(),
+             (unsigned long long)metrics.counter(COUNTER_BOOK_MOVES));
+    out += line;
+
+    static const char* const COMMAND_NAMES[COMMAND_COUNT] = {"CONNECT", "MOVE", "BOARD", "PLAY_BOT", "STATS", "WATCH", "RESUME", "BOOK", "UNKNOWN"};
+    for (int i = 0; i < COMMAND_COUNT; i++) {
+        appendSummary(out, ("STATS command " + std::string(COMMAND_NAMES[i])).c_str(), MetricHistogram(HIST_COMMAND_CONNECT + i));
+    }
+    appendSummary(out, "STATS latency move_validation", HIST_MOVE_VALIDATION);
+    appendSummary(out, "STATS latency make_move", HIST_MAKE_MOVE);
+    appendSummary(out, "STATS latency send", HIST_SEND);
+    appendSummary(out, "STATS latency match_wait", HIST_MATCH_WAIT);
+    appendSummary(out, "STATS latency journal_sync", HIST_JOURNAL_SYNC);
+
+    // Dla mutexów histogram zawiera tylko zajęcia, które musiały czekać.
+    struct LockMetric { const char* name; MetricCounter acquisitions; MetricHistogram wait; };
+    static const LockMetric LOCKS[] = {
+        {"players", COUNTER_LOCK_PLAYERS, HIST_WAIT_PLAYERS},
+        {"session", COUNTER_LOCK_SESSION, HIST_WAIT_SESSION},
+        {"game_table", COUNTER_LOCK_GAME_TABLE, HIST_WAIT_GAME_TABLE},
+    };
+    for (const LockMetric& lock : LOCKS) {
+        snprintf(line, sizeof(line), "STATS lock %s acquired %llu contended", lock.name,
+                 (unsigned long long)metrics.counter(lock.acquisitions));
+        appendSummary(out, line, lock.wait);
+    }
+    out += "STATS_END\n";
+    queueMessage(conn, std::make_shared<const std::string>(std::move(out)));
+}
+
+// Wołający trzyma session->mutex.
+void GameServer::scheduleBotMove(const std::shared_ptr<GameSession>& session) {
+    if (session->botLevel == 0 || session->game->getCurrentPlayer() != 2) return;
+    botPool.submit([this, session] { playBotMove(session); });
+}
+
+void GameServer::playBotMove(const std::shared_ptr<GameSession>& session) {
+    Board board;
+    int chainSquare;
+    int level;
+    SearchLimits limits;
+    {
+        MeasuredLock lock(session->mutex, HIST_WAIT_SESSION, COUNTER_LOCK_SESSION);
+        if (session->finished || session->game->getCurrentPlayer() != 2) return;
+        board = session->game->getBoard();
+        chainSquare = session->game->getChainSquare();
+        level = session->botLevel;
+        limits.maxDepth = BOT_LEVELS[session->botLevel - 1].maxDepth;
+        limits.timeMs = BOT_LEVELS[session->botLevel - 1].timeMs;
+        limits.threads = 1 + searchHelpers;
+        limits.pool = &searchPool;
+    }
+    // Przeszukiwanie bez blokady sesji: w tym czasie człowiek i tak nie ma ruchu. Pozycje
+    // z księgi otwarć i z zasięgu bazy końcówek nie wymagają przeszukiwania.
+    SearchResult result;
+    TablebaseProbe endgame;
+    if (chainSquare < 0 && pickBookMove(board, level, result.move)) {
+        result.found = true;
+        metricCount(COUNTER_BOOK_MOVES);
+        LOG_DEBUG("Komputer: ruch z księgi otwarć");
+    } else if (chainSquare < 0 && tablebase.bestMove(board, false, result.move, endgame)) {
+        result.found = true;
+        metricCount(COUNTER_TABLEBASE_MOVES);
+        LOG_DEBUG("Komputer: ruch z bazy końcówek, wynik %d po %d półruchach", endgame.result, endgame.distance);
+    } else {
+        result = SearchEngine(board, false, chainSquare, limits, &transpositions).run();
+    }
+    {
+        MeasuredLock lock(session->mutex, HIST_WAIT_SESSION, COUNTER_LOCK_SESSION);
+        if (session->finished || session->game->getCurrentPlayer() != 2) return;
+        if (clockExpired(*session, 1)) {
+            flagFall(*session, 1);
+            flushPendingWrites();
+            return;
+        }
+        if (!result.found) {
+            LOG_INFO("Komputer nie ma dozwolonego ruchu");
+            forfeitBot(*session);
+            flushPendingWrites();
+            return;
+        }
+        LOG_DEBUG("Komputer: głębokość %d, ocena %d, węzły %llu", result.depth, result.score,
+                  (unsigned long long)result.nodes);
+        // Ruch silnika to cały łańcuch bić; serwer wykonuje go skok po skoku jak ruchy gracza.
+        int from = result.move.from;
+        bool played = true;
+        for (int i = 0; i < result.move.hops; i++) {
+            int to = result.move.path[i];
+            int fromX = squareRow(from), fromY = squareCol(from);
+            int toX = squareRow(to), toY = squareCol(to);
+            played = session->game->isValidMove(fromX, fromY, toX, toY, false);
+            if (!played) {
+                LOG_ERROR("Komputer wybrał niedozwolony skok (%d,%d) -> (%d,%d)", fromX, fromY, toX, toY);
+                break;
             }
+            playHop(*session, 1, fromX, fromY, toX, toY);
+            from = to;
         }
-   }
+        if (played) finishIfOver(*session);
+        else forfeitBot(*session);
+    }
+    flushPendingWrites();
 }
 
-void GameServer::handleClient(int clientSocket) {
-    char buffer[1024];
-    std::string playerName;
+// Komputer, który nie może wykonać ruchu (brak ruchów albo błąd silnika), oddaje partię, aby gra
+// nie czekała bez końca na jego ruch; wołający trzyma session.mutex.
+void GameServer::forfeitBot(GameSession& session) {
+    OutMessage gameOver = makeGameOver("white");
+    sendToPlayer(session, 0, gameOver);
+    broadcastToWatchers(session, gameOver);
+    endSession(session);
+}
+
+// Ruch czarnych z księgi otwarć. Słabsze poziomy losują ruch z częstością, z jaką grano go
+// w archiwum, co urozmaica ich otwarcia; mocniejsze biorą ruch z najlepszym wynikiem czarnych
+// wśród dobrze zbadanych, a bez takich najczęściej grany.
+bool GameServer::pickBookMove(const Board& board, int level, Move& move) {
+    if (!book.loaded()) return false;
+    BookMove moves[MAX_MOVES];
+    int count = book.bookMoves(board, false, moves, MAX_MOVES);
+    if (count == 0) return false;
+    if (level <= BOOK_RANDOM_LEVELS) {
+        thread_local std::mt19937_64 rng(std::random_device{}());
+        uint64_t total = 0;
+        for (int i = 0; i < count; i++) total += moves[i].stats.games;
+        uint64_t pick = rng() % total;
+        for (int i = 0; i < count; i++) {
+            if (pick < moves[i].stats.games) {
+                move = moves[i].move;
+                return true;
+            }
+            pick -= moves[i].stats.games;
+        }
+    }
+    int best = 0;
+    double bestScore = -1;
+    for (int i = 0; i < count; i++) {
+        const BookEntry& stats = moves[i].stats;
+        if (stats.games < BOOK_MIN_GAMES) continue;
+        double score = (stats.blackWins + 0.5 * stats.draws()) / stats.games;
+        if (score > bestScore) {
+            bestScore = score;
+            best = i;
+        }
+    }
+    move = moves[best].move;
+    return true;
+}
+
+// Komunikaty wygenerowane przez wątek czekają na zapis do końca bieżącej partii zdarzeń.
+thread_local std::vector<std::shared_ptr<Connection>> pendingFlushes;
+
+// Komunikat dla obserwatorów gry: sformatowany raz, z migawką listy obserwatorów z chwili ruchu.
+struct PendingBroadcast {
+    std::shared_ptr<const WatcherList> watchers;
+    OutMessage message;
+};
+thread_local std::vector<PendingBroadcast> pendingBroadcasts;
+
+// Wołający trzyma session.mutex. Samo rozesłanie odbywa się w flushPendingWrites, już po
+// zapisaniu komunikatów graczy i bez blokady sesji.
+void GameServer::broadcastToWatchers(GameSession& session, const OutMessage& message) {
+    if (!session.watcherJoins.empty()) publishWatchers(session);
+    if (session.watchers && !session.watchers->empty()) {
+        pendingBroadcasts.push_back({session.watchers, message});
+    }
+}
+
+void GameServer::queueMessage(const std::shared_ptr<Connection>& conn, const std::shared_ptr<const std::string>& data) {
+    {
+        std::lock_guard<std::mutex> lock(conn->writeMutex);
+        if (conn->closed) return;
+        bool watcher = conn->watching.load(std::memory_order_relaxed) != NO_GAME;
+        if (conn->queuedBytes + data->size() > (watcher ? WATCHER_MAX_OUTBOUND_BYTES : MAX_OUTBOUND_BYTES)) {
+            // Odbiorca nie czyta: shutdown budzi jego pętlę zdarzeń, która zamknie połączenie.
+            LOG_WARN("Przepełniona kolejka wychodząca %s, zamykanie połączenia",
+                     watcher ? "obserwatora" : conn->displayName());
+            if (watcher) metricCount(COUNTER_WATCHERS_DROPPED);
+            conn->outQueue.clear();
+            conn->outHead = conn->outOffset = conn->queuedBytes = 0;
+            shutdown(conn->fd, SHUT_RDWR);
+            return;
+        }
+        conn->outQueue.push_back(data);
+        conn->queuedBytes += data->size();
+        if (conn->flushScheduled) return;
+        conn->flushScheduled = true;
+    }
+    pendingFlushes.push_back(conn);
+}
+
+void GameServer::flushPendingWrites() {
+    // Zamiana na lokalny wektor: flush może dopisać kolejne wpisy (np. po zamknięciu gracza).
+    std::vector<std::shared_ptr<Connection>> batch;
+    batch.swap(pendingFlushes);
+    for (const auto& conn : batch) {
+        flushConnection(*conn);
+    }
+    if (pendingBroadcasts.empty()) return;
+    // Gracze dostali już swoje komunikaty; teraz ten sam bufor trafia do kolejek obserwatorów.
+    std::vector<PendingBroadcast> broadcasts;
+    broadcasts.swap(pendingBroadcasts);
+    for (const PendingBroadcast& broadcast : broadcasts) {
+        for (const Watcher& watcher : *broadcast.watchers) {
+            if (!watcher.active()) continue;
+            queueMessage(watcher.conn, watcher.conn->binary.load(std::memory_order_relaxed) ? broadcast.message.binary : broadcast.message.text);
+        }
+    }
+    batch.clear();
+    batch.swap(pendingFlushes);
+    for (const auto& conn : batch) {
+        flushConnection(*conn);
+    }
+}
+
+void GameServer::updateEpollEvents(Connection& conn) {
+    uint32_t events = EPOLLRDHUP;
+    if (conn.queuedBytes < OUTBOUND_PAUSE_BYTES) events |= EPOLLIN;
+    if (conn.queuedBytes > 0) events |= EPOLLOUT;
+    if (events == conn.epollEvents) return;
+    conn.epollEvents = events;
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.ptr = &conn;
+    epoll_ctl(conn.loop->epollFd, EPOLL_CTL_MOD, conn.fd, &ev);
+}
+
+void GameServer::flushConnection(Connection& conn) {
+    std::lock_guard<std::mutex> lock(conn.writeMutex);
+    conn.flushScheduled = false;
+    if (conn.closed) return;
+    while (conn.outHead < conn.outQueue.size()) {
+        iovec iov[64];
+        int count = 0;
+        for (size_t i = conn.outHead; i < conn.outQueue.size() && count < 64; i++, count++) {
+            const std::string& data = *conn.outQueue[i];
+            size_t skip = (i == conn.outHead) ? conn.outOffset : 0;
+            iov[count].iov_base = const_cast<char*>(data.data()) + skip;
+            iov[count].iov_len = data.size() - skip;
+        }
+        uint64_t sendStart = metricsNow();
+        ssize_t written = writev(conn.fd, iov, count);
+        metricRecord(HIST_SEND, metricsNow() - sendStart);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            break;  // EAGAIN: resztę wyśle EPOLLOUT; inne błędy obsłuży pętla zdarzeń
+        }
+        metricCount(COUNTER_BYTES_SENT, written);
+        conn.queuedBytes -= written;
+        size_t left = written;
+        while (left > 0) {
+            size_t remaining = conn.outQueue[conn.outHead]->size() - conn.outOffset;
+            if (left < remaining) {
+                conn.outOffset += left;
+                break;
+            }
+            left -= remaining;
+            conn.outQueue[conn.outHead++].reset();
+            conn.outOffset = 0;
+        }
+    }
+    if (conn.outHead == conn.outQueue.size()) {
+        conn.outQueue.clear();
+        conn.outHead = 0;
+    }
+    updateEpollEvents(conn);
+}
+
+void GameServer::handleReadable(const std::shared_ptr<Connection>& conn) {
+    char buffer[4096];
+    ssize_t bytesRead = recv(conn->fd, buffer, sizeof(buffer), 0);
+    if (bytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return;
+    if (bytesRead <= 0) {
+        LOG_INFO("Klient rozłączony: %s", conn->playerName.c_str());
+        closeConnection(conn);
+        return;
+    }
+    conn->lastActivityMs.store(steadyMillis(std::chrono::steady_clock::now()), std::memory_order_relaxed);
+    conn->inBuffer.append(buffer, bytesRead);
+    // Ramkowanie po '\n': jeden odczyt może zawierać kilka komend albo tylko fragment jednej.
+    size_t start = 0;
+    size_t newline;
+    while (!conn->binary && (newline = conn->inBuffer.find('\n', start)) != std::string::npos) {
+        processCommand(std::string_view(conn->inBuffer).substr(start, newline - start), conn);
+        start = newline + 1;
+    }
+    // Po wynegocjowaniu trybu binarnego reszta strumienia to ramki o stałym nagłówku.
+    while (conn->binary && conn->inBuffer.size() - start >= BINARY_HEADER_SIZE) {
+        uint8_t type = uint8_t(conn->inBuffer[start]);
+        size_t length = uint8_t(conn->inBuffer[start + 1]);
+        if (conn->inBuffer.size() - start < BINARY_HEADER_SIZE + length) break;
+        processBinaryFrame(type, std::string_view(conn->inBuffer).substr(start + BINARY_HEADER_SIZE, length), conn);
+        start += BINARY_HEADER_SIZE + length;
+    }
+    conn->inBuffer.erase(0, start);
+    // Niedokończona komenda czeka na resztę; klient bez '\n' nie może rozdąć bufora.
+    if (conn->inBuffer.size() > MAX_COMMAND_LENGTH) {
+        LOG_WARN("Zbyt długa komenda od %s, zamykanie połączenia", conn->playerName.c_str());
+        closeConnection(conn);
+    }
+}
+
+void GameServer::closeConnection(const std::shared_ptr<Connection>& conn) {
+    {
+        std::lock_guard<std::mutex> lock(conn->writeMutex);
+        if (conn->closed) return;
+        conn->closed = true;
+        conn->outQueue.clear();
+        conn->queuedBytes = 0;
+    }
+    metricCount(COUNTER_CONNECTIONS_CLOSED);
+    epoll_ctl(conn->loop->epollFd, EPOLL_CTL_DEL, conn->fd, nullptr);
+    {
+        // Usuwamy wpis przed close(), aby nowe połączenie z tym samym numerem fd go nie nadpisało.
+        std::lock_guard<std::mutex> lock(conn->loop->connectionsMutex);
+        conn->loop->connections.erase(conn->fd);
+    }
+    close(conn->fd);
+    stopWatching(conn);
+    removePlayer(conn);
+}
+
+void GameServer::runEventLoop(EventLoop* loop) {
+    epoll_event events[64];
     while (true) {
-        memset(buffer, 0, sizeof(buffer));
-        int bytesRead = recv(clientSocket, buffer, sizeof(buffer) - 1, 0);
-        if (bytesRead <= 0) {
-            std::cout << "Klient rozłączony: " << playerName << std::endl;
-            break;
+        int count = epoll_wait(loop->epollFd, events, 64, -1);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("epoll_wait nie powiodło się: %s", strerror(errno));
+            return;
+        }
+        for (int i = 0; i < count; i++) {
+            std::shared_ptr<Connection> conn = static_cast<Connection*>(events[i].data.ptr)->shared_from_this();
+            if (events[i].events & EPOLLOUT) {
+                flushConnection(*conn);
+            }
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                handleReadable(conn);
+            }
         }
-        processCommand(std::string(buffer), clientSocket, playerName);
+        flushPendingWrites();
     }
-    close(clientSocket);
-    removePlayer(playerName);
 }
 
 void GameServer::start() {
-    std::cout << "Serwer oczekuje na połączenia...\n";
+    LOG_INFO("Serwer oczekuje na połączenia...");
+    for (auto& loop : loops) {
+        loop->thread = std::thread(&GameServer::runEventLoop, this, loop.get());
+    }
+    botPool.start(BOT_WORKERS);
+    searchPool.start(searchHelpers);
+    timerThread = std::thread(&GameServer::runTimers, this);
+    matchThread = std::thread(&GameServer::runMatchmaker, this);
     while (true) {
         sockaddr_in clientAddr;
         socklen_t clientLen = sizeof(clientAddr);
-        int clientSocket = accept(serverSocket, (struct sockaddr*)&clientAddr, &clientLen);
+        int clientSocket = accept4(serverSocket, (struct sockaddr*)&clientAddr, &clientLen, SOCK_NONBLOCK);
         if (clientSocket < 0) {
-            perror("Akceptacja połączenia nie powiodła się");
+            LOG_ERROR("Akceptacja połączenia nie powiodła się: %s", strerror(errno));
             continue;
         }
-        std::cout << "Nowe połączenie przyjęte\n";
-        std::thread clientThread(&GameServer::handleClient, this, clientSocket);
-        clientThread.detach();
+        LOG_DEBUG("Nowe połączenie przyjęte");
+        metricCount(COUNTER_CONNECTIONS_ACCEPTED);
+        // Połączenia rozdzielamy po kolei między pętle zdarzeń.
+        auto conn = std::make_shared<Connection>();
+        conn->fd = clientSocket;
+        conn->loop = loops[nextLoop++ % loops.size()].get();
+        if (idleTimeout.count() > 0) {
+            auto now = std::chrono::steady_clock::now();
+            conn->lastActivityMs.store(steadyMillis(now), std::memory_order_relaxed);
+            conn->timers = &timers;
+            conn->idleTimer.kind = TIMER_IDLE;
+            conn->idleTimer.conn = conn.get();
+            timers.schedule(conn->idleTimer, now + idleTimeout);
+        }
+        {
+            std::lock_guard<std::mutex> lock(conn->loop->connectionsMutex);
+            conn->loop->connections[clientSocket] = conn;
+        }
+        epoll_event ev{};
+        ev.events = conn->epollEvents;
+        ev.data.ptr = conn.get();
+        if (epoll_ctl(conn->loop->epollFd, EPOLL_CTL_ADD, clientSocket, &ev) < 0) {
+            LOG_ERROR("Rejestracja w epoll nie powiodła się: %s", strerror(errno));
+            closeConnection(conn);
+            flushPendingWrites();
+        }
     }
 }
 
-int main() {
-    GameServer server(12345);
+int main(int argc, char** argv) {
+    ServerOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--bot-threads=", 0) == 0) options.botThreads = atoi(arg.c_str() + 14);
+        else if (arg.rfind("--tt-mb=", 0) == 0 && atoi(arg.c_str() + 8) > 0) options.ttMegabytes = atoi(arg.c_str() + 8);
+        else if (arg.rfind("--grace-seconds=", 0) == 0) options.graceSeconds = atoi(arg.c_str() + 16);
+        else if (arg.rfind("--journal=", 0) == 0) options.journalPath = arg.substr(10);
+        else if (arg.rfind("--clock=", 0) == 0) {
+            // "--clock=SEKUNDY" albo "--clock=SEKUNDY+PRZYROST"
+            options.clockSeconds = atoi(arg.c_str() + 8);
+            size_t plus = arg.find('+');
+            options.incrementSeconds = plus == std::string::npos ? 0 : atoi(arg.c_str() + plus + 1);
+        }
+        else if (arg.rfind("--idle-seconds=", 0) == 0) options.idleSeconds = atoi(arg.c_str() + 15);
+        else if (arg.rfind("--tablebase=", 0) == 0) options.tablebasePath = arg.substr(12);
+        else if (arg.rfind("--book=", 0) == 0) options.bookPath = arg.substr(7);
+        else if (arg == "--log-level=debug") {
+            if (LOG_MIN_LEVEL > LEVEL_DEBUG) fprintf(stderr, "Komunikaty DEBUG nie są wkompilowane (opcja CMake WARCABY_DEBUG_LOG)\n");
+            Logger::instance().setLevel(LEVEL_DEBUG);
+        }
+        else if (arg == "--log-level=info") Logger::instance().setLevel(LEVEL_INFO);
+        else if (arg == "--log-level=warn") Logger::instance().setLevel(LEVEL_WARN);
+        else if (arg == "--log-level=error") Logger::instance().setLevel(LEVEL_ERROR);
+        else {
+            fprintf(stderr, "Użycie: %s [--log-level=debug|info|warn|error] [--bot-threads=N] [--tt-mb=N] [--journal=PLIK] [--grace-seconds=N] [--clock=S[+P]] [--idle-seconds=N] [--tablebase=PLIK] [--book=PLIK]\n", argv[0]);
+            return 1;
+        }
+    }
+    // Zapis do zamkniętego gniazda ma zwrócić EPIPE zamiast zabić proces.
+    signal(SIGPIPE, SIG_IGN);
+    GameServer server(options);
     server.start();
     return 0;
 }
@@ -0,0 +1,70 @@
+#include "timing_wheel.h"
+
+static void unlink(TimerNode* node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = node->next = nullptr;
+}
+
+TimingWheel::TimingWheel() {
+    for (auto& level : heads) {
+        for (TimerNode& head : level) head.prev = head.next = &head;
+    }
+}
+
+// Poziom wynika z odległości od bieżącego tiku, slot z bezwzględnego numeru tiku.
+void TimingWheel::link(TimerNode* node) {
+    uint64_t delta = node->expires - current;
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= (uint64_t(1) << (SLOT_BITS * (level + 1)))) level++;
+    int slot = int((node->expires >> (SLOT_BITS * level)) & (SLOTS - 1));
+    TimerNode* head = &heads[level][slot];
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+void TimingWheel::schedule(TimerNode* node, uint64_t tick) {
+    if (node->linked()) unlink(node);
+    else count++;
+    uint64_t horizon = current + (uint64_t(1) << (SLOT_BITS * LEVELS)) - 1;
+    node->expires = tick <= current ? current + 1 : tick < horizon ? tick : horizon;
+    link(node);
+}
+
+void TimingWheel::cancel(TimerNode* node) {
+    if (!node->linked()) return;
+    unlink(node);
+    count--;
+}
+
+// Rozkłada slot wyższego poziomu na niższe; każdy timer jest przenoszony co najwyżej raz na poziom.
+void TimingWheel::cascade(int level, int slot) {
+    TimerNode* head = &heads[level][slot];
+    TimerNode* node = head->next;
+    head->prev = head->next = head;
+    while (node != head) {
+        TimerNode* next = node->next;
+        link(node);
+        node = next;
+    }
+}
+
+void TimingWheel::advance(uint64_t now, std::vector<TimerNode*>& expired) {
+    while (current < now) {
+        current++;
+        for (int level = 1; level < LEVELS; level++) {
+            if (current & ((uint64_t(1) << (SLOT_BITS * level)) - 1)) break;
+            cascade(level, int((current >> (SLOT_BITS * level)) & (SLOTS - 1)));
+        }
+        // Na poziomie 0 slot zawiera tylko timery z tym dokładnie tikiem.
+        TimerNode* head = &heads[0][current & (SLOTS - 1)];
+        while (head->next != head) {
+            TimerNode* node = head->next;
+            unlink(node);
+            count--;
+            expired.push_back(node);
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// Węzeł timera osadzony w obiekcie, którego dotyczy (gra, połączenie): koło nie alokuje
+// pamięci, a wstawienie i anulowanie to przepięcie wskaźników listy dwukierunkowej.
+struct TimerNode {
+    TimerNode* prev = nullptr;
+    TimerNode* next = nullptr;
+    uint64_t expires = 0;    // numer tiku
+
+    TimerNode() = default;
+    TimerNode(const TimerNode&) = delete;
+    TimerNode& operator=(const TimerNode&) = delete;
+    bool linked() const { return prev != nullptr; }
+};
+
+// Hierarchiczne koło czasowe: 4 poziomy po 256 slotów, więc horyzont to 2^32 tików.
+// Timer trafia na poziom odpowiadający jego odległości, a gdy niższy poziom zatacza pełny
+// obrót, slot wyższego poziomu jest rozkładany niżej. Wstawienie i anulowanie są O(1),
+// a przesunięcie o tik kosztuje O(1) plus liczbę wygasłych i przenoszonych timerów,
+// niezależnie od liczby wszystkich timerów. Klasa nie jest synchronizowana.
+class TimingWheel {
+public:
+    static const int SLOT_BITS = 8;
+    static const int SLOTS = 1 << SLOT_BITS;
+    static const int LEVELS = 4;
+
+    TimingWheel();
+    // Ustawia (lub przestawia) timer na dany tik; tik z przeszłości wygaśnie przy najbliższym advance.
+    void schedule(TimerNode* node, uint64_t tick);
+    void cancel(TimerNode* node);
+    // Przesuwa koło do tiku now i dopisuje wygasłe (już odpięte) timery do expired.
+    void advance(uint64_t now, std::vector<TimerNode*>& expired);
+    uint64_t currentTick() const { return current; }
+    size_t size() const { return count; }
+
+private:
+    TimerNode heads[LEVELS][SLOTS];   // wartowniki list cyklicznych
+    uint64_t current = 0;
+    size_t count = 0;
+
+    void link(TimerNode* node);
+    void cascade(int level, int slot);
+};
@@ -0,0 +1,679 @@
+// Analizator archiwum partii: powtarza zapisane gry regułami serwera (Game::isValidMove/makeMove)
+// i opisuje każdą jednym wierszem: legalność, wynik zapisany i wynikający z pozycji, liczba
+// posunięć, bicia oraz wahania materiału.
+//
+// Plik jest mapowany w całości przez mmap i dzielony na fragmenty (domyślnie 8 MB) wyrównane
+// do początków gier. Wątki pobierają kolejne fragmenty licznikiem atomowym i analizują je
+// własnym obiektem Game, więc poza licznikiem i kolejnością wypisywania nic nie jest wspólne,
+// a przepustowość rośnie z liczbą rdzeni. Wiersze trafiają na wyjście w kolejności pliku.
+//
+// PDN: pola 1-32 numerowane wierszami od strony czarnych (pole n to indeks n - 1 planszy),
+// zaczynają białe. Ruch "a-b" albo bicie "axb", "axbxc" (także z ':'); skrócony zapis bicia
+// wielokrotnego jest rozwijany do jedynej pasującej sekwencji. Komentarze {} i ; oraz warianty ()
+// są pomijane. Fragmenty są wyrównywane do sekcji tagów, więc plik bez tagów analizuje jeden wątek.
+//
+// Notacja serwera: linie "MOVE <x> <y> <x> <y>" (pojedyncze skoki, jak w protokole)
+// i opcjonalnie "GAME_OVER <wynik>"; gry oddziela pusta linia.
+//
+// Z --book=PLIK analizator kompiluje księgę otwarć: pozycje z pierwszych --book-plies półruchów
+// poprawnych partii o znanym wyniku, ze statystyką wyników, do pliku mapowanego przez serwer.
+//
+// Z --tablebase=PLIK każda pozycja w zasięgu bazy końcówek jest oceniana dokładnie: raport
+// dostaje wynik teoretyczny przy wejściu w końcówkę i liczbę posunięć, które go zmieniły.
+//
+// Wiersze raportu idą na stdout, podsumowanie na stderr; kod wyjścia 1 oznacza, że co najmniej
+// jedna gra zawiera niedozwolony ruch.
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "board.h"
+#include "book.h"
+#include "endgame.h"
+#include "game.h"
+#include "logger.h"
+
+enum InputFormat { FORMAT_AUTO, FORMAT_PDN, FORMAT_SERVER };
+
+struct AnalyzeOptions {
+    int threads = 0;                 // 0 = po jednym na rdzeń
+    size_t chunkBytes = 8 << 20;
+    InputFormat format = FORMAT_AUTO;
+    bool summaryOnly = false;
+    std::string tablebasePath;
+    std::string bookPath;
+    int bookPlies = 20;
+    uint32_t bookMinGames = 1;
+    std::string path;
+};
+
+struct Totals {
+    uint64_t games = 0;
+    uint64_t ok = 0;
+    uint64_t illegal = 0;
+    uint64_t mismatch = 0;
+    uint64_t plies = 0;
+    uint64_t endgameErrors = 0;
+
+    void add(const Totals& other) {
+        games += other.games;
+        ok += other.ok;
+        illegal += other.illegal;
+        mismatch += other.mismatch;
+        plies += other.plies;
+        endgameErrors += other.endgameErrors;
+    }
+};
+
+const char* const RESULT_UNKNOWN = "*";
+
+// Materiał w pionkach; damka jest warta trzy.
+static int material(uint32_t pieces, uint32_t kings) {
+    return __builtin_popcount(pieces & ~kings) + 3 * __builtin_popcount(pieces & kings);
+}
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Statystyki pozycji do księgi. Wpisy są dopisywane po kolei i co jakiś czas sortowane
+// i scalane, więc pamięć rośnie z liczbą różnych pozycji, a nie ich wystąpień.
+class BookCollector {
+public:
+    void addGame(std::vector<uint64_t>& keys, const char* result);
+    void append(BookCollector& other);
+    std::vector<BookEntry>& compact();
+
+private:
+    std::vector<BookEntry> entries;
+    size_t compacted = 0;
+};
+
+void BookCollector::addGame(std::vector<uint64_t>& keys, const char* result) {
+    // Pozycja powtórzona w partii liczy się raz.
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    uint32_t white = strcmp(result, "white") == 0;
+    uint32_t black = strcmp(result, "black") == 0;
+    for (uint64_t key : keys) entries.push_back({key, 1, white, black, 0});
+    if (entries.size() >= std::max<size_t>(2 * compacted, 1 << 20)) compact();
+}
+
+void BookCollector::append(BookCollector& other) {
+    entries.insert(entries.end(), other.entries.begin(), other.entries.end());
+    std::vector<BookEntry>().swap(other.entries);
+}
+
+std::vector<BookEntry>& BookCollector::compact() {
+    std::sort(entries.begin(), entries.end(), [](const BookEntry& a, const BookEntry& b) { return a.key < b.key; });
+    size_t out = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (out > 0 && entries[out - 1].key == entries[i].key) {
+            entries[out - 1].games += entries[i].games;
+            entries[out - 1].whiteWins += entries[i].whiteWins;
+            entries[out - 1].blackWins += entries[i].blackWins;
+        } else {
+            entries[out++] = entries[i];
+        }
+    }
+    entries.resize(out);
+    compacted = out;
+    return entries;
+}
+
+// Powtarza jedną partię na obiekcie Game wielokrotnego użytku. Po pierwszym błędzie kolejne
+// ruchy są pomijane, a gra jest raportowana jako niedozwolona.
+class GameReplay {
+public:
+    GameReplay(const EndgameTablebase* tablebase, BookCollector* book, int bookPlies)
+        : tablebase(tablebase), book(book), bookPlies(bookPlies) {}
+    void start(size_t offset);
+    void playFull(const int* squares, int count);
+    void playHop(int fromX, int fromY, int toX, int toY);
+    void fail(const std::string& message);
+    void finish(const char* declared, std::string* out, Totals& totals);
+
+private:
+    Game game;
+    size_t offset = 0;
+    int plies = 0;
+    int captures = 0;
+    int balance = 0;
+    int balanceMin = 0;
+    int balanceMax = 0;
+    int swings = 0;
+    int leader = 0;          // znak ostatniej niezerowej przewagi
+    bool over = false;
+    const char* computed = RESULT_UNKNOWN;
+    std::string error;
+    const EndgameTablebase* tablebase;
+    const char* endgame = RESULT_UNKNOWN;     // wynik teoretyczny przy wejściu w bazę końcówek
+    const char* theoretical = RESULT_UNKNOWN; // wynik teoretyczny bieżącej pozycji
+    int endgameErrors = 0;
+    BookCollector* book;
+    int bookPlies;
+    std::vector<uint64_t> positions;          // klucze pozycji z początku partii, do księgi
+
+    void endPly();
+    void probeEndgame(bool whiteToMove);
+};
+
+void GameReplay::start(size_t gameOffset) {
+    game.reset(0, 1);
+    offset = gameOffset;
+    plies = captures = balance = balanceMin = balanceMax = swings = leader = 0;
+    over = false;
+    computed = RESULT_UNKNOWN;
+    error.clear();
+    endgame = theoretical = RESULT_UNKNOWN;
+    endgameErrors = 0;
+    positions.clear();
+    if (book) positions.push_back(game.getHash());
+}
+
+void GameReplay::fail(const std::string& message) {
+    if (error.empty()) error = "posunięcie " + std::to_string(plies + 1) + ": " + message;
+}
+
+// Koniec posunięcia: zmiana strony, bilans materiału i sprawdzenie końca gry. Strona bez
+// dozwolonego ruchu przegrywa, choć serwer tego nie ogłasza.
+void GameReplay::endPly() {
+    bool whiteMoved = game.getCurrentPlayer() == 1;
+    game.setCurrentPlayer(whiteMoved ? 2 : 1);
+    plies++;
+    const Board& board = game.getBoard();
+    balance = material(board.white, board.kings) - material(board.black, board.kings);
+    balanceMin = std::min(balanceMin, balance);
+    balanceMax = std::max(balanceMax, balance);
+    int sign = (balance > 0) - (balance < 0);
+    if (sign != 0) {
+        if (leader != 0 && sign != leader) swings++;
+        leader = sign;
+    }
+    if (game.isDraw()) {
+        over = true;
+        computed = "draw";
+    } else if (game.getWhiteCount() == 0 || game.getBlackCount() == 0) {
+        over = true;
+        computed = game.getWhiteCount() == 0 ? "black" : "white";
+    } else if (game.getLegalMoves(!whiteMoved).count == 0) {
+        over = true;
+        computed = whiteMoved ? "white" : "black";
+    }
+    if (tablebase && !over) probeEndgame(!whiteMoved);
+    if (book && plies <= bookPlies) positions.push_back(game.getHash());
+}
+
+// Posunięcie, po którym wynik teoretyczny się zmienił, oddało wygraną albo remis.
+void GameReplay::probeEndgame(bool whiteToMove) {
+    TablebaseProbe probe = tablebase->probe(game.getBoard(), whiteToMove);
+    if (probe.result == TB_UNKNOWN) return;
+    const char* result = probe.result == TB_DRAW ? "draw" : (probe.result == TB_WIN) == whiteToMove ? "white" : "black";
+    if (endgame == RESULT_UNKNOWN) endgame = result;
+    else if (strcmp(result, theoretical) != 0) endgameErrors++;
+    theoretical = result;
+}
+
+// Pełny ruch z PDN: pola 1-32, co najmniej dwa. Dwa pola przy biciu wielokrotnym oznaczają
+// skrócony zapis; wtedy pasujące sekwencje z generatora ruchów muszą zbijać te same pionki.
+void GameReplay::playFull(const int* squares, int count) {
+    if (!error.empty()) return;
+    if (over) {
+        fail("ruch po końcu gry");
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        if (squares[i] < 1 || squares[i] > 32) {
+            fail("pole " + std::to_string(squares[i]) + " poza planszą");
+            return;
+        }
+    }
+    bool isWhite = game.getCurrentPlayer() == 1;
+    const Move* match = nullptr;
+    int matches = 0;
+    for (const Move& move : game.getLegalMoves(isWhite)) {
+        if (move.from != squares[0] - 1 || move.to() != squares[count - 1] - 1) continue;
+        if (count > 2) {
+            if (move.hops != count - 1) continue;
+            bool samePath = true;
+            for (int i = 0; i < move.hops && samePath; i++) samePath = move.path[i] == squares[i + 1] - 1;
+            if (!samePath) continue;
+        }
+        // Różne drogi bicia tych samych pionków dają tę samą pozycję, więc nie są niejednoznaczne.
+        if (match && match->captured == move.captured) continue;
+        match = &move;
+        matches++;
+    }
+    // Zapis ruchu jest składany tylko do komunikatu o błędzie.
+    auto notation = [&] {
+        std::string text = std::to_string(squares[0]);
+        for (int i = 1; i < count; i++) text += "-" + std::to_string(squares[i]);
+        return text;
+    };
+    if (matches != 1) {
+        fail((matches == 0 ? "niedozwolony ruch " : "niejednoznaczny ruch ") + notation());
+        return;
+    }
+    // Lista ruchów gry jest unieważniana przez makeMove, więc pracujemy na kopii.
+    Move move = *match;
+    if (move.isCapture()) captures++;
+    int from = move.from;
+    for (int i = 0; i < move.hops; i++) {
+        int to = move.path[i];
+        if (!game.isValidMove(squareRow(from), squareCol(from), squareRow(to), squareCol(to), isWhite)) {
+            fail("Game odrzuca skok " + std::to_string(from + 1) + "-" + std::to_string(to + 1) + " w " + notation());
+            return;
+        }
+        game.makeMove(squareRow(from), squareCol(from), squareRow(to), squareCol(to), isWhite ? 0 : 1);
+        from = to;
+    }
+    if (game.isCaptureChainPending()) {
+        fail("niedokończone bicie " + notation());
+        return;
+    }
+    endPly();
+}
+
+// Pojedynczy skok w notacji serwera; posunięcie kończy się, gdy nie ma kontynuacji bicia.
+void GameReplay::playHop(int fromX, int fromY, int toX, int toY) {
+    if (!error.empty()) return;
+    if (over) {
+        fail("ruch po końcu gry");
+        return;
+    }
+    bool isWhite = game.getCurrentPlayer() == 1;
+    if (squareIndex(fromX, fromY) < 0 || squareIndex(toX, toY) < 0 ||
+        !game.isValidMove(fromX, fromY, toX, toY, isWhite)) {
+        fail("niedozwolony skok " + std::to_string(fromX) + " " + std::to_string(fromY) + " " + std::to_string(toX) +
+             " " + std::to_string(toY));
+        return;
+    }
+    bool chainStart = !game.isCaptureChainPending();
+    int enemyBefore = isWhite ? game.getBlackCount() : game.getWhiteCount();
+    game.makeMove(fromX, fromY, toX, toY, isWhite ? 0 : 1);
+    int enemyAfter = isWhite ? game.getBlackCount() : game.getWhiteCount();
+    if (chainStart && enemyAfter < enemyBefore) captures++;
+    if (!game.isCaptureChainPending()) endPly();
+}
+
+// Wiersz raportu: przesunięcie w pliku, status, posunięcia, wynik zapisany i wynikający z gry,
+// bicia, najmniejszy i największy bilans materiału (białe minus czarne), zmiany prowadzenia,
+// bilans końcowy, opis błędu.
+void GameReplay::finish(const char* declared, std::string* out, Totals& totals) {
+    if (error.empty() && game.isCaptureChainPending()) fail("niedokończone bicie na końcu zapisu");
+    const char* status = "ok";
+    if (!error.empty()) {
+        status = "illegal";
+        totals.illegal++;
+    } else if (declared != RESULT_UNKNOWN && computed != RESULT_UNKNOWN && strcmp(declared, computed) != 0) {
+        // Zapisany wynik bez końca gry na planszy (poddanie, czas) nie jest rozbieżnością.
+        status = "mismatch";
+        totals.mismatch++;
+    } else {
+        totals.ok++;
+        const char* result = declared != RESULT_UNKNOWN ? declared : computed;
+        if (book && result != RESULT_UNKNOWN) book->addGame(positions, result);
+    }
+    totals.games++;
+    totals.plies += plies;
+    totals.endgameErrors += endgameErrors;
+    if (!out) return;
+    char line[160];
+    snprintf(line, sizeof(line), "%zu\t%s\t%d\t%s\t%s\t%d\t%d\t%d\t%d\t%d\t", offset, status, plies, declared, computed,
+             captures, balanceMin, balanceMax, swings, balance);
+    *out += line;
+    if (tablebase) {
+        snprintf(line, sizeof(line), "%s\t%d\t", endgame, endgameErrors);
+        *out += line;
+    }
+    *out += error.empty() ? "-" : error;
+    *out += '\n';
+}
+
+// Zwraca wynik dla tokenu wyniku PDN albo nullptr, gdy token nim nie jest.
+static const char* pdnResult(std::string_view token) {
+    if (token == "1-0" || token == "2-0") return "white";
+    if (token == "0-1" || token == "0-2") return "black";
+    if (token == "1/2-1/2" || token == "1-1") return "draw";
+    if (token == "*") return RESULT_UNKNOWN;
+    return nullptr;
+}
+
+static size_t lineEnd(const char* data, size_t pos, size_t end) {
+    const void* newline = memchr(data + pos, '\n', end - pos);
+    return newline ? size_t(static_cast<const char*>(newline) - data) : end;
+}
+
+static size_t previousLineStart(const char* data, size_t pos) {
+    size_t start = pos - 1;
+    while (start > 0 && data[start - 1] != '\n') start--;
+    return start;
+}
+
+static bool isBlankLine(const char* data, size_t pos, size_t end) {
+    for (size_t i = pos; i < end && data[i] != '\n'; i++) {
+        if (!isSpace(data[i])) return false;
+    }
+    return true;
+}
+
+// Początek gry to w PDN początek sekcji tagów (linia od '[' po linii bez '['), a w notacji
+// serwera niepusta linia po pustej. Zwraca pierwszy taki początek od pos albo size.
+static size_t alignToGame(const char* data, size_t size, size_t pos, InputFormat format) {
+    if (pos == 0) return 0;
+    while (pos < size && data[pos - 1] != '\n') pos++;
+    while (pos < size) {
+        if (format == FORMAT_PDN) {
+            if (data[pos] == '[' && data[previousLineStart(data, pos)] != '[') return pos;
+        } else if (!isBlankLine(data, pos, size) && isBlankLine(data, previousLineStart(data, pos), size)) {
+            return pos;
+        }
+        pos = lineEnd(data, pos, size) + 1;
+    }
+    return size;
+}
+
+// Pomija komentarz {...}, ;... albo wariant (...) zaczynający się na pos.
+static size_t skipComment(const char* data, size_t pos, size_t end) {
+    if (data[pos] == ';') return lineEnd(data, pos, end);
+    if (data[pos] == '{') {
+        const void* close = memchr(data + pos, '}', end - pos);
+        return close ? size_t(static_cast<const char*>(close) - data) + 1 : end;
+    }
+    int depth = 0;
+    for (; pos < end; pos++) {
+        if (data[pos] == '{') {
+            pos = skipComment(data, pos, end) - 1;
+        } else if (data[pos] == '(') {
+            depth++;
+        } else if (data[pos] == ')' && --depth == 0) {
+            return pos + 1;
+        }
+    }
+    return end;
+}
+
+// Token ruchu PDN, np. "12.32-28", "28x19", "23x14x5!"; false dla numeru posunięcia i NAG.
+static bool parsePdnMove(std::string_view token, int* squares, int& count, bool& isMove) {
+    size_t dot = token.find_last_of('.');
+    if (dot != std::string_view::npos) token.remove_prefix(dot + 1);
+    while (!token.empty() && (token.back() == '!' || token.back() == '?' || token.back() == '+')) token.remove_suffix(1);
+    isMove = !token.empty() && token[0] != '$';
+    if (!isMove) return true;
+    count = 0;
+    while (true) {
+        int square;
+        auto result = std::from_chars(token.data(), token.data() + token.size(), square);
+        if (result.ec != std::errc() || count == MAX_CAPTURE_CHAIN + 1) return false;
+        squares[count++] = square;
+        token.remove_prefix(result.ptr - token.data());
+        if (token.empty()) return count >= 2;
+        if (token[0] != '-' && token[0] != 'x' && token[0] != ':') return false;
+        token.remove_prefix(1);
+    }
+}
+
+static void analyzePdn(const char* data, size_t begin, size_t end, GameReplay& replay, std::string* out,
+                       Totals& totals) {
+    size_t pos = begin;
+    while (pos < end) {
+        while (pos < end && isSpace(data[pos])) pos++;
+        if (pos >= end) break;
+        replay.start(pos);
+        const char* declared = RESULT_UNKNOWN;
+        bool tagResult = false;
+        while (pos < end && data[pos] == '[') {
+            size_t tagEnd = lineEnd(data, pos, end);
+            std::string_view tag(data + pos, tagEnd - pos);
+            if (tag.rfind("[Result ", 0) == 0) {
+                size_t open = tag.find('"'), close = tag.rfind('"');
+                if (open != close) {
+                    const char* result = pdnResult(tag.substr(open + 1, close - open - 1));
+                    if (result) {
+                        declared = result;
+                        tagResult = true;
+                    }
+                }
+            }
+            pos = tagEnd;
+            while (pos < end && isSpace(data[pos])) pos++;
+        }
+        while (pos < end) {
+            char c = data[pos];
+            if (c == '[' && data[pos - 1] == '\n') break;   // kolejna gra bez tokenu wyniku
+            if (isSpace(c)) {
+                pos++;
+                continue;
+            }
+            if (c == '{' || c == ';' || c == '(') {
+                pos = skipComment(data, pos, end);
+                continue;
+            }
+            size_t tokenEnd = pos;
+            while (tokenEnd < end && !isSpace(data[tokenEnd]) && data[tokenEnd] != '{' && data[tokenEnd] != '(' &&
+                   data[tokenEnd] != ';') {
+                tokenEnd++;
+            }
+            std::string_view token(data + pos, tokenEnd - pos);
+            pos = tokenEnd;
+            if (const char* result = pdnResult(token)) {
+                if (!tagResult) declared = result;
+                break;
+            }
+            int squares[MAX_CAPTURE_CHAIN + 1];
+            int count;
+            bool isMove;
+            if (!parsePdnMove(token, squares, count, isMove)) {
+                replay.fail("nieczytelny zapis " + std::string(token));
+            } else if (isMove) {
+                replay.playFull(squares, count);
+            }
+        }
+        replay.finish(declared, out, totals);
+    }
+}
+
+static std::string_view nextToken(std::string_view& rest) {
+    size_t start = 0;
+    while (start < rest.size() && isSpace(rest[start])) start++;
+    size_t end = start;
+    while (end < rest.size() && !isSpace(rest[end])) end++;
+    std::string_view token = rest.substr(start, end - start);
+    rest.remove_prefix(end);
+    return token;
+}
+
+static bool parseInt(std::string_view token, int& value) {
+    auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+    return result.ec == std::errc() && result.ptr == token.data() + token.size();
+}
+
+static void analyzeServerNotation(const char* data, size_t begin, size_t end, GameReplay& replay, std::string* out,
+                                  Totals& totals) {
+    size_t pos = begin;
+    while (pos < end) {
+        while (pos < end && isSpace(data[pos])) pos++;
+        if (pos >= end) break;
+        replay.start(pos);
+        const char* declared = RESULT_UNKNOWN;
+        while (pos < end) {
+            size_t next = lineEnd(data, pos, end);
+            std::string_view rest(data + pos, next - pos);
+            pos = std::min(next + 1, end);
+            std::string_view command = nextToken(rest);
+            if (command.empty()) break;
+            if (command == "MOVE") {
+                int move[4];
+                bool parsed = true;
+                for (int& value : move) parsed = parsed && parseInt(nextToken(rest), value);
+                if (parsed) replay.playHop(move[0], move[1], move[2], move[3]);
+                else replay.fail("nieczytelna linia MOVE");
+            } else if (command == "GAME_OVER") {
+                std::string_view result = nextToken(rest);
+                declared = result == "white" ? "white" : result == "black" ? "black" : result == "draw" ? "draw"
+                                                                                                  : RESULT_UNKNOWN;
+            } else {
+                replay.fail("nieznana linia " + std::string(command));
+            }
+        }
+        replay.finish(declared, out, totals);
+    }
+}
+
+static void printUsage(const char* program) {
+    fprintf(stderr, "Użycie: %s [--threads=N] [--chunk-mb=N] [--format=pdn|server] [--tablebase=PLIK] [--book=PLIK] [--summary] PLIK\n", program);
+    fprintf(stderr, "  --threads=N     wątki analizy (domyślnie po jednym na rdzeń)\n");
+    fprintf(stderr, "  --chunk-mb=N    wielkość fragmentu pliku przydzielanego wątkowi (domyślnie 8)\n");
+    fprintf(stderr, "  --format=F      format wejścia; domyślnie wykrywany (\"MOVE\" na początku = serwer)\n");
+    fprintf(stderr, "  --tablebase=P   baza końcówek z tbgen: kolumny endgame i endgame_errors\n");
+    fprintf(stderr, "  --book=P        kompiluje księgę otwarć z poprawnych partii do pliku P\n");
+    fprintf(stderr, "  --book-plies=N  głębokość księgi w półruchach (domyślnie 20)\n");
+    fprintf(stderr, "  --book-min-games=N  pomija pozycje z mniej niż N partii (domyślnie 1)\n");
+    fprintf(stderr, "  --summary       tylko podsumowanie, bez wierszy dla gier\n");
+}
+
+int main(int argc, char** argv) {
+    AnalyzeOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--threads=", 0) == 0) options.threads = atoi(arg.c_str() + 10);
+        else if (arg.rfind("--chunk-mb=", 0) == 0 && atoi(arg.c_str() + 11) > 0) options.chunkBytes = size_t(atoi(arg.c_str() + 11)) << 20;
+        else if (arg == "--format=pdn") options.format = FORMAT_PDN;
+        else if (arg == "--format=server") options.format = FORMAT_SERVER;
+        else if (arg.rfind("--tablebase=", 0) == 0) options.tablebasePath = arg.substr(12);
+        else if (arg.rfind("--book=", 0) == 0) options.bookPath = arg.substr(7);
+        else if (arg.rfind("--book-plies=", 0) == 0) options.bookPlies = atoi(arg.c_str() + 13);
+        else if (arg.rfind("--book-min-games=", 0) == 0) options.bookMinGames = uint32_t(std::max(1, atoi(arg.c_str() + 17)));
+        else if (arg == "--summary") options.summaryOnly = true;
+        else if (arg[0] != '-' && options.path.empty()) options.path = arg;
+        else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.path.empty()) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    if (options.threads <= 0) options.threads = std::max(1u, std::thread::hardware_concurrency());
+    // Game loguje koniec każdej partii; przy milionach gier zostawiamy tylko błędy.
+    Logger::instance().setLevel(LEVEL_ERROR);
+    EndgameTablebase tablebase;
+    if (!options.tablebasePath.empty() && !tablebase.open(options.tablebasePath)) {
+        fprintf(stderr, "Nie można wczytać bazy końcówek %s\n", options.tablebasePath.c_str());
+        return 2;
+    }
+    const EndgameTablebase* endgames = tablebase.loaded() ? &tablebase : nullptr;
+
+    int fd = open(options.path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) < 0) {
+        perror("Otwarcie pliku nie powiodło się");
+        return 1;
+    }
+    size_t size = size_t(info.st_size);
+    const char* data = nullptr;
+    if (size > 0) {
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            perror("mmap nie powiodło się");
+            return 1;
+        }
+        // Każdy wątek czyta swój fragment po kolei.
+        madvise(mapped, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(mapped);
+    }
+    close(fd);
+    if (options.format == FORMAT_AUTO) {
+        size_t first = 0;
+        while (first < size && isSpace(data[first])) first++;
+        options.format = size - first >= 4 && memcmp(data + first, "MOVE", 4) == 0 ? FORMAT_SERVER : FORMAT_PDN;
+    }
+
+    size_t chunkCount = std::max<size_t>(1, (size + options.chunkBytes - 1) / options.chunkBytes);
+    std::atomic<size_t> nextChunk{0};
+    // Wyniki fragmentów czekają, aż zostaną wypisane wszystkie wcześniejsze.
+    std::mutex outputMutex;
+    std::vector<std::string> outputs(chunkCount);
+    std::vector<char> finished(chunkCount, 0);
+    size_t nextOutput = 0;
+    Totals totals;
+    BookCollector book;
+    if (!options.summaryOnly) {
+        printf("# offset\tstatus\tplies\tdeclared\tcomputed\tcaptures\tbalance_min\tbalance_max\tswings\tbalance\t%serror\n",
+               endgames ? "endgame\tendgame_errors\t" : "");
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto work = [&] {
+        BookCollector localBook;
+        GameReplay replay(endgames, options.bookPath.empty() ? nullptr : &localBook, options.bookPlies);
+        Totals local;
+        size_t chunk;
+        while ((chunk = nextChunk.fetch_add(1, std::memory_order_relaxed)) < chunkCount) {
+            size_t begin = alignToGame(data, size, chunk * options.chunkBytes, options.format);
+            size_t end = chunk + 1 == chunkCount ? size
+                                                 : alignToGame(data, size, (chunk + 1) * options.chunkBytes, options.format);
+            std::string out;
+            std::string* target = options.summaryOnly ? nullptr : &out;
+            if (options.format == FORMAT_PDN) analyzePdn(data, begin, end, replay, target, local);
+            else analyzeServerNotation(data, begin, end, replay, target, local);
+            std::lock_guard<std::mutex> lock(outputMutex);
+            outputs[chunk] = std::move(out);
+            finished[chunk] = 1;
+            while (nextOutput < chunkCount && finished[nextOutput]) {
+                fwrite(outputs[nextOutput].data(), 1, outputs[nextOutput].size(), stdout);
+                std::string().swap(outputs[nextOutput]);
+                nextOutput++;
+            }
+        }
+        std::lock_guard<std::mutex> lock(outputMutex);
+        totals.add(local);
+        book.append(localBook);
+    };
+    std::vector<std::thread> threads;
+    for (int t = 1; t < options.threads; t++) threads.emplace_back(work);
+    work();
+    for (auto& thread : threads) thread.join();
+    fflush(stdout);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    fprintf(stderr, "Gry: %llu (poprawne %llu, niedozwolone %llu, rozbieżny wynik %llu), posunięcia: %llu\n",
+            (unsigned long long)totals.games, (unsigned long long)totals.ok, (unsigned long long)totals.illegal,
+            (unsigned long long)totals.mismatch, (unsigned long long)totals.plies);
+    if (endgames) {
+        fprintf(stderr, "Baza końcówek: do %d bierek, posunięcia zmieniające wynik teoretyczny: %llu\n",
+                tablebase.pieces(), (unsigned long long)totals.endgameErrors);
+    }
+    fprintf(stderr, "Format: %s, wątki: %d, fragmenty: %zu, czas: %.2f s, %.1f MB/s, %.0f gier/s\n",
+            options.format == FORMAT_PDN ? "PDN" : "serwer", options.threads, chunkCount, seconds,
+            size / 1e6 / seconds, totals.games / seconds);
+    if (!options.bookPath.empty()) {
+        std::vector<BookEntry>& entries = book.compact();
+        size_t positions = entries.size();
+        entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                     [&](const BookEntry& e) { return e.games < options.bookMinGames; }),
+                      entries.end());
+        if (!OpeningBook::write(options.bookPath, entries, options.bookPlies)) {
+            perror("Zapis księgi otwarć nie powiódł się");
+            return 1;
+        }
+        fprintf(stderr, "Księga %s: %zu pozycji (z %zu różnych, co najmniej %u partii), do półruchu %d\n",
+                options.bookPath.c_str(), entries.size(), positions, options.bookMinGames, options.bookPlies);
+    }
+    if (data) munmap(const_cast<char*>(data), size);
+    return totals.illegal > 0 ? 1 : 0;
+}
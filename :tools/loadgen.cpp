@@ -0,0 +1,537 @@
+// Generator obciążenia: otwiera N połączeń do lokalnego serwera, każde wysyła CONNECT,
+// czeka na sparowanie w kolejce oczekujących i rozgrywa losową partię dozwolonymi ruchami.
+// Po końcu gry (GAME_OVER, rozłączenie przeciwnika, brak ruchów) klient łączy się ponownie.
+//
+// Klient śledzi planszę na podstawie MOVE_UPDATE tym samym generatorem ruchów co serwer,
+// więc każdy wysłany ruch powinien być poprawny; INVALID_MOVE oznacza rozjazd stanu.
+// Mierzone są: czas zestawienia połączenia (TCP i do GAME_START), czas odpowiedzi na MOVE
+// (od wysłania do otrzymania własnego MOVE_UPDATE), liczba ruchów na sekundę i błędy.
+//
+// Tryb --pipeline wysyła wszystkie skoki wielokrotnego bicia w jednym zapisie, bez czekania
+// na potwierdzenie poprzedniego skoku.
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "board.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct LoadOptions {
+    std::string host = "127.0.0.1";
+    int port = 12345;
+    int connections = 1000;
+    int threads = 4;
+    int durationSeconds = 10;
+    int maxPlies = 200;          // dłuższe partie są porzucane (serwer nie kończy gry bez ruchów)
+    int turnTimeoutMs = 5000;    // brak wiadomości w trakcie gry dłużej niż tyle = zawieszona gra
+    bool pipeline = false;
+};
+
+// Liczniki jednego wątku; sumowane po zakończeniu. Pola atomowe czyta wątek raportu.
+struct LoadStats {
+    std::atomic<uint64_t> moves{0};
+    std::atomic<uint64_t> gamesFinished{0};
+    uint64_t gamesAbandoned = 0;
+    uint64_t opponentDisconnected = 0;
+    uint64_t timeouts = 0;
+    uint64_t invalidMove = 0;
+    uint64_t noGameFound = 0;
+    uint64_t notYourTurn = 0;
+    uint64_t desync = 0;
+    uint64_t connectErrors = 0;
+    uint64_t connectionsLost = 0;
+    std::vector<uint32_t> connectMicros;   // connect() do gotowości gniazda
+    std::vector<uint32_t> pairingMicros;   // connect() do GAME_START
+    std::vector<uint32_t> moveMicros;      // MOVE do własnego MOVE_UPDATE
+};
+
+enum class ClientState {
+    Idle,         // czeka na ponowne połączenie
+    Connecting,
+    Waiting,      // po CONNECT, przed GAME_START
+    Playing
+};
+
+struct Client {
+    int fd = -1;
+    ClientState state = ClientState::Idle;
+    std::string name;
+    bool isWhite = false;
+    Board board;
+    int chainSquare = -1;
+    int plies = 0;
+    std::deque<Clock::time_point> sentMoves;   // czasy wysłania skoków bez MOVE_UPDATE
+    std::string input;
+    std::string output;
+    Clock::time_point connectStart;
+    Clock::time_point lastActivity;
+    Clock::time_point retryAt;
+};
+
+static uint32_t microsSince(Clock::time_point start, Clock::time_point now) {
+    return uint32_t(std::chrono::duration_cast<std::chrono::microseconds>(now - start).count());
+}
+
+static std::string_view nextToken(std::string_view& rest) {
+    size_t start = rest.find_first_not_of(' ');
+    if (start == std::string_view::npos) {
+        rest = {};
+        return {};
+    }
+    rest.remove_prefix(start);
+    size_t end = rest.find(' ');
+    std::string_view token = rest.substr(0, end);
+    rest = end == std::string_view::npos ? std::string_view() : rest.substr(end);
+    return token;
+}
+
+static int parseNumber(std::string_view token) {
+    int value = 0;
+    for (char c : token) {
+        if (c < '0' || c > '9') return -1;
+        value = value * 10 + (c - '0');
+    }
+    return token.empty() ? -1 : value;
+}
+
+// Wątek obsługuje własną grupę klientów na osobnym epoll, jak pętle zdarzeń serwera.
+class LoadWorker {
+public:
+    LoadWorker(const LoadOptions& options, const sockaddr_in& address, int firstClient, int clientCount,
+               std::atomic<bool>& stop)
+        : options(options), address(address), stop(stop), rng(uint32_t(firstClient) * 2654435761u + 1) {
+        epollFd = epoll_create1(0);
+        if (epollFd < 0) {
+            perror("Tworzenie epoll nie powiodło się");
+            exit(1);
+        }
+        clients.resize(clientCount);
+        for (int i = 0; i < clientCount; i++) {
+            clients[i].name = "lg" + std::to_string(getpid()) + "_" + std::to_string(firstClient + i);
+        }
+    }
+
+    ~LoadWorker() { close(epollFd); }
+
+    LoadStats stats;
+
+    void run() {
+        for (size_t i = 0; i < clients.size(); i++) startConnect(i);
+        epoll_event events[256];
+        Clock::time_point nextScan = Clock::now();
+        while (!stop.load(std::memory_order_relaxed)) {
+            int n = epoll_wait(epollFd, events, 256, 50);
+            for (int i = 0; i < n; i++) {
+                size_t index = events[i].data.u64;
+                Client& client = clients[index];
+                if (client.fd < 0) continue;
+                if (client.state == ClientState::Connecting) {
+                    finishConnect(index);
+                    continue;
+                }
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    stats.connectionsLost++;
+                    reconnect(index);
+                    continue;
+                }
+                if (events[i].events & EPOLLOUT) flush(index);
+                if (client.fd >= 0 && (events[i].events & EPOLLIN)) readInput(index);
+            }
+            Clock::time_point now = Clock::now();
+            if (now >= nextScan) {
+                scanTimeouts(now);
+                nextScan = now + std::chrono::milliseconds(100);
+            }
+        }
+        for (Client& client : clients) {
+            if (client.fd >= 0) close(client.fd);
+        }
+    }
+
+private:
+    const LoadOptions& options;
+    sockaddr_in address;
+    std::atomic<bool>& stop;
+    std::mt19937 rng;
+    int epollFd;
+    std::vector<Client> clients;
+
+    void startConnect(size_t index) {
+        Client& client = clients[index];
+        std::string name = std::move(client.name);
+        client = Client{};
+        client.name = std::move(name);
+        client.connectStart = Clock::now();
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (fd < 0) {
+            connectFailed(index);
+            return;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        // Zamknięcie wysyła RST: przy tysiącach ponownych połączeń TIME_WAIT wyczerpałby porty.
+        linger noLinger{1, 0};
+        setsockopt(fd, SOL_SOCKET, SO_LINGER, &noLinger, sizeof(noLinger));
+        if (connect(fd, (const sockaddr*)&address, sizeof(address)) < 0 && errno != EINPROGRESS) {
+            close(fd);
+            connectFailed(index);
+            return;
+        }
+        client.fd = fd;
+        client.state = ClientState::Connecting;
+        epoll_event ev{};
+        ev.events = EPOLLOUT;
+        ev.data.u64 = index;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+    }
+
+    void connectFailed(size_t index) {
+        stats.connectErrors++;
+        clients[index].state = ClientState::Idle;
+        clients[index].retryAt = Clock::now() + std::chrono::milliseconds(100);
+    }
+
+    void finishConnect(size_t index) {
+        Client& client = clients[index];
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(client.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+            closeClient(client);
+            connectFailed(index);
+            return;
+        }
+        Clock::time_point now = Clock::now();
+        stats.connectMicros.push_back(microsSince(client.connectStart, now));
+        client.state = ClientState::Waiting;
+        client.lastActivity = now;
+        client.output = "CONNECT " + client.name + "\n";
+        flush(index);
+    }
+
+    void closeClient(Client& client) {
+        if (client.fd >= 0) {
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, client.fd, nullptr);
+            close(client.fd);
+            client.fd = -1;
+        }
+    }
+
+    void reconnect(size_t index) {
+        closeClient(clients[index]);
+        if (!stop.load(std::memory_order_relaxed)) startConnect(index);
+    }
+
+    void scanTimeouts(Clock::time_point now) {
+        for (size_t i = 0; i < clients.size(); i++) {
+            Client& client = clients[i];
+            if (client.state == ClientState::Idle && now >= client.retryAt) {
+                startConnect(i);
+            } else if (client.state == ClientState::Playing &&
+                       now - client.lastActivity > std::chrono::milliseconds(options.turnTimeoutMs)) {
+                stats.timeouts++;
+                reconnect(i);
+            }
+        }
+    }
+
+    void flush(size_t index) {
+        Client& client = clients[index];
+        while (!client.output.empty()) {
+            ssize_t n = write(client.fd, client.output.data(), client.output.size());
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                stats.connectionsLost++;
+                reconnect(index);
+                return;
+            }
+            client.output.erase(0, size_t(n));
+        }
+        // Pierwsze wywołanie po connect() przełącza gniazdo z EPOLLOUT na EPOLLIN.
+        epoll_event ev{};
+        ev.events = EPOLLIN | (client.output.empty() ? 0u : uint32_t(EPOLLOUT));
+        ev.data.u64 = index;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, client.fd, &ev);
+    }
+
+    void readInput(size_t index) {
+        Client& client = clients[index];
+        char buffer[4096];
+        for (;;) {
+            ssize_t n = read(client.fd, buffer, sizeof(buffer));
+            if (n > 0) {
+                client.input.append(buffer, size_t(n));
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            stats.connectionsLost++;
+            reconnect(index);
+            return;
+        }
+        Clock::time_point now = Clock::now();
+        client.lastActivity = now;
+        size_t start = 0, end;
+        while ((end = client.input.find('\n', start)) != std::string::npos) {
+            std::string_view line(client.input.data() + start, end - start);
+            start = end + 1;
+            if (!handleLine(index, line, now)) return;   // klient połączył się od nowa
+        }
+        client.input.erase(0, start);
+        if (client.fd >= 0 && !client.output.empty()) flush(index);
+    }
+
+    // Zwraca false, gdy klient został rozłączony i bufor wejściowy jest nieaktualny.
+    bool handleLine(size_t index, std::string_view line, Clock::time_point now) {
+        Client& client = clients[index];
+        std::string_view rest = line;
+        std::string_view command = nextToken(rest);
+        if (command == "COLOR") {
+            client.isWhite = nextToken(rest) == "white";
+        } else if (command == "GAME_START") {
+            stats.pairingMicros.push_back(microsSince(client.connectStart, now));
+            client.state = ClientState::Playing;
+            client.board = START_BOARD;
+            client.chainSquare = -1;
+            client.plies = 0;
+        } else if (command == "YOUR_TURN") {
+            if (client.sentMoves.empty()) return takeTurn(index);
+        } else if (command == "MOVE_UPDATE") {
+            return handleMoveUpdate(index, rest, now);
+        } else if (command == "GAME_OVER") {
+            // Każdą grę liczy tylko biały, żeby nie liczyć jej dwa razy.
+            if (client.isWhite) stats.gamesFinished.fetch_add(1, std::memory_order_relaxed);
+            reconnect(index);
+            return false;
+        } else if (command == "OPPONENT_DISCONNECTED" || command == "OPPONENT_AWAY") {
+            // Przeciwnik porzucił partię; nie czekamy, aż serwer zakończy ją po okresie karencji.
+            stats.opponentDisconnected++;
+            reconnect(index);
+            return false;
+        } else if (command == "INVALID_MOVE" || command == "NO_GAME_FOUND" || command == "NOT_YOUR_TURN") {
+            if (command == "INVALID_MOVE") stats.invalidMove++;
+            else if (command == "NO_GAME_FOUND") stats.noGameFound++;
+            else stats.notYourTurn++;
+            reconnect(index);
+            return false;
+        }
+        return true;
+    }
+
+    bool handleMoveUpdate(size_t index, std::string_view rest, Clock::time_point now) {
+        Client& client = clients[index];
+        int coords[4];
+        for (int& c : coords) c = parseNumber(nextToken(rest));
+        bool serverCapture = nextToken(rest) == "CAPTURE";
+        int fromSq = squareIndex(coords[0], coords[1]);
+        int toSq = squareIndex(coords[2], coords[3]);
+        if (fromSq < 0 || toSq < 0 || !(client.board.occupied() & (1u << fromSq))) {
+            stats.desync++;
+            reconnect(index);
+            return false;
+        }
+        bool moverWhite = client.board.white & (1u << fromSq);
+        bool promoted;
+        int capturedSq = client.board.playHop(fromSq, toSq, moverWhite, promoted);
+        if ((capturedSq >= 0) != serverCapture) {
+            stats.desync++;
+            reconnect(index);
+            return false;
+        }
+        if (moverWhite == client.isWhite) {
+            if (client.sentMoves.empty()) {
+                stats.desync++;
+                reconnect(index);
+                return false;
+            }
+            stats.moveMicros.push_back(microsSince(client.sentMoves.front(), now));
+            stats.moves.fetch_add(1, std::memory_order_relaxed);
+            client.sentMoves.pop_front();
+        }
+        // Ta sama reguła kontynuacji bicia co w Game::makeMove.
+        bool chain = capturedSq >= 0 && !promoted && client.board.captureTargets(toSq, moverWhite);
+        client.chainSquare = chain ? toSq : -1;
+        if (!chain) client.plies++;
+        return true;
+    }
+
+    bool takeTurn(size_t index) {
+        Client& client = clients[index];
+        if (client.state != ClientState::Playing) return true;
+        // Serwer wysyła YOUR_TURN przed GAME_OVER, więc bez bierek czekamy na koniec gry.
+        if (client.board.own(client.isWhite) == 0) return true;
+        MoveList list;
+        client.board.generateMoves(client.isWhite, client.chainSquare, list);
+        if (list.count == 0 || client.plies >= options.maxPlies) {
+            stats.gamesAbandoned++;
+            reconnect(index);
+            return false;
+        }
+        const Move& move = list.moves[rng() % list.count];
+        // Bez --pipeline wysyłamy jeden skok i czekamy na YOUR_TURN przed następnym.
+        int hops = (options.pipeline && client.chainSquare < 0) ? move.hops : 1;
+        Clock::time_point now = Clock::now();
+        int from = move.from;
+        char text[32];
+        for (int i = 0; i < hops; i++) {
+            int to = move.path[i];
+            snprintf(text, sizeof(text), "MOVE %d %d %d %d\n", squareRow(from), squareCol(from),
+                     squareRow(to), squareCol(to));
+            client.output += text;
+            client.sentMoves.push_back(now);
+            from = to;
+        }
+        return true;
+    }
+};
+
+static uint32_t percentile(std::vector<uint32_t>& samples, double fraction) {
+    if (samples.empty()) return 0;
+    size_t k = std::min(samples.size() - 1, size_t(fraction * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+    return samples[k];
+}
+
+static void printLatency(const char* label, std::vector<uint32_t>& samples) {
+    // Wyrównanie liczone w znakach, nie bajtach (polskie litery zajmują dwa bajty).
+    int width = 0;
+    for (const char* p = label; *p; p++) width += (*p & 0xC0) != 0x80;
+    printf("%s%*s", label, std::max(1, 22 - width), "");
+    if (samples.empty()) {
+        printf("brak próbek\n");
+        return;
+    }
+    uint32_t p50 = percentile(samples, 0.50);
+    uint32_t p99 = percentile(samples, 0.99);
+    uint32_t p999 = percentile(samples, 0.999);
+    uint32_t max = *std::max_element(samples.begin(), samples.end());
+    printf("p50 %8.3f ms  p99 %8.3f ms  p999 %8.3f ms  max %8.3f ms  (%zu próbek)\n",
+           p50 / 1000.0, p99 / 1000.0, p999 / 1000.0, max / 1000.0, samples.size());
+}
+
+static void printUsage(const char* program) {
+    fprintf(stderr,
+            "Użycie: %s [--host=ADRES] [--port=N] [--connections=N] [--threads=N] [--duration=S]\n"
+            "          [--max-plies=N] [--turn-timeout-ms=N] [--pipeline]\n",
+            program);
+}
+
+int main(int argc, char** argv) {
+    LoadOptions options;
+    options.threads = std::max(1u, std::min(4u, std::thread::hardware_concurrency()));
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--host=", 0) == 0) options.host = arg.substr(7);
+        else if (arg.rfind("--port=", 0) == 0) options.port = atoi(arg.c_str() + 7);
+        else if (arg.rfind("--connections=", 0) == 0) options.connections = atoi(arg.c_str() + 14);
+        else if (arg.rfind("--threads=", 0) == 0) options.threads = atoi(arg.c_str() + 10);
+        else if (arg.rfind("--duration=", 0) == 0) options.durationSeconds = atoi(arg.c_str() + 11);
+        else if (arg.rfind("--max-plies=", 0) == 0) options.maxPlies = atoi(arg.c_str() + 12);
+        else if (arg.rfind("--turn-timeout-ms=", 0) == 0) options.turnTimeoutMs = atoi(arg.c_str() + 18);
+        else if (arg == "--pipeline") options.pipeline = true;
+        else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.connections < 2 || options.threads < 1 || options.durationSeconds < 1) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    options.threads = std::min(options.threads, options.connections);
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(options.port);
+    if (inet_pton(AF_INET, options.host.c_str(), &address.sin_addr) != 1) {
+        fprintf(stderr, "Niepoprawny adres: %s\n", options.host.c_str());
+        return 2;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("Połączenia: %d, wątki: %d, czas: %d s, pipelining: %s\n", options.connections, options.threads,
+           options.durationSeconds, options.pipeline ? "tak" : "nie");
+    std::atomic<bool> stop{false};
+    std::vector<std::unique_ptr<LoadWorker>> workers;
+    int first = 0;
+    for (int t = 0; t < options.threads; t++) {
+        int count = options.connections / options.threads + (t < options.connections % options.threads ? 1 : 0);
+        workers.push_back(std::make_unique<LoadWorker>(options, address, first, count, stop));
+        first += count;
+    }
+    std::vector<std::thread> threads;
+    Clock::time_point start = Clock::now();
+    for (auto& worker : workers) threads.emplace_back([&worker] { worker->run(); });
+
+    uint64_t lastMoves = 0;
+    for (int second = 1; second <= options.durationSeconds; second++) {
+        std::this_thread::sleep_until(start + std::chrono::seconds(second));
+        uint64_t moves = 0, games = 0;
+        for (auto& worker : workers) {
+            moves += worker->stats.moves.load(std::memory_order_relaxed);
+            games += worker->stats.gamesFinished.load(std::memory_order_relaxed);
+        }
+        printf("[%3d s] ruchy/s: %8llu  ukończone gry: %llu\n", second, (unsigned long long)(moves - lastMoves),
+               (unsigned long long)games);
+        fflush(stdout);
+        lastMoves = moves;
+    }
+    stop.store(true);
+    for (auto& thread : threads) thread.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    LoadStats total;
+    uint64_t moves = 0, games = 0;
+    for (auto& worker : workers) {
+        LoadStats& s = worker->stats;
+        moves += s.moves.load();
+        games += s.gamesFinished.load();
+        total.gamesAbandoned += s.gamesAbandoned;
+        total.opponentDisconnected += s.opponentDisconnected;
+        total.timeouts += s.timeouts;
+        total.invalidMove += s.invalidMove;
+        total.noGameFound += s.noGameFound;
+        total.notYourTurn += s.notYourTurn;
+        total.desync += s.desync;
+        total.connectErrors += s.connectErrors;
+        total.connectionsLost += s.connectionsLost;
+        total.connectMicros.insert(total.connectMicros.end(), s.connectMicros.begin(), s.connectMicros.end());
+        total.pairingMicros.insert(total.pairingMicros.end(), s.pairingMicros.begin(), s.pairingMicros.end());
+        total.moveMicros.insert(total.moveMicros.end(), s.moveMicros.begin(), s.moveMicros.end());
+    }
+
+    printf("\nWyniki po %.1f s\n", seconds);
+    printLatency("Połączenie TCP:", total.connectMicros);
+    printLatency("Do GAME_START:", total.pairingMicros);
+    printLatency("Odpowiedź na MOVE:", total.moveMicros);
+    printf("Ruchy: %llu (%.0f/s)\n", (unsigned long long)moves, moves / seconds);
+    printf("Gry: ukończone %llu, porzucone %llu, rozłączony przeciwnik %llu, bez odpowiedzi %llu\n",
+           (unsigned long long)games, (unsigned long long)total.gamesAbandoned,
+           (unsigned long long)total.opponentDisconnected, (unsigned long long)total.timeouts);
+    printf("Błędy: INVALID_MOVE %llu, NO_GAME_FOUND %llu, NOT_YOUR_TURN %llu, niezgodny stan %llu\n",
+           (unsigned long long)total.invalidMove, (unsigned long long)total.noGameFound,
+           (unsigned long long)total.notYourTurn, (unsigned long long)total.desync);
+    printf("Połączenia: nieudane %llu, zerwane %llu\n", (unsigned long long)total.connectErrors,
+           (unsigned long long)total.connectionsLost);
+    bool protocolErrors = total.invalidMove || total.noGameFound || total.notYourTurn || total.desync;
+    return protocolErrors ? 1 : 0;
+}
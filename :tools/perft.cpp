@@ -0,0 +1,181 @@
+// Perft: liczy liście drzewa ruchów do zadanej głębokości i porównuje je ze znanymi
+// wartościami. Służy jako bramka regresji dla generatora ruchów (poprawność i szybkość).
+//
+// Dwa tryby liczenia:
+//  - generator: Board::generateMoves + applyMove/undoMove, pełne ruchy (z łańcuchami bić),
+//  - gra: pojedyncze skoki przez Game::isValidMove/makeMove, czyli ścieżka serwera;
+//    kontynuacja bicia nie zmienia głębokości, więc oba tryby liczą te same liście.
+//
+// Wartości referencyjne policzono niezależnie pierwotną implementacją reguł (plansza
+// jako vector<vector<int>>), zanim powstały bitboardy.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "board.h"
+#include "game.h"
+
+struct PerftPosition {
+    const char* name;
+    // 32 ciemne pola po kolei (wiersze oddzielone spacją): . puste, w/b pionek, W/B damka.
+    const char* squares;
+    bool whiteToMove;
+    int knownDepth;
+    uint64_t expected[8];
+};
+
+static const PerftPosition POSITIONS[] = {
+    {"start", "bbbb bbbb bbbb .... .... wwww wwww wwww", true,
+     8, {7, 49, 302, 1469, 7482, 37986, 190146, 929902}},
+    // Trzy damki; biała damka bije z dowolnej odległości, łańcuchy do trzech bić.
+    {"damki", "..W. bbb. ..b. w.b. .... .w.. .w.B ..B.", true,
+     7, {7, 72, 459, 2893, 16761, 110795, 617732}},
+    // Czarna damka ma dwanaście łańcuchów bić, najdłuższe po pięć zbitych pionków.
+    {"lancuchy", ".... b..b .... .w.. .ww. .... wWw. w..B", false,
+     8, {12, 44, 327, 1118, 7371, 24267, 151350, 507556}},
+    // Dwie białe damki i pionek mogą bić; łańcuchy różnej długości z kilku pól.
+    {"otwarte", "WbW. .... bbb. .... .b.w ww.. .... ....", true,
+     8, {14, 40, 209, 514, 2187, 3870, 28690, 55051}},
+};
+
+static const int POSITION_COUNT = sizeof(POSITIONS) / sizeof(POSITIONS[0]);
+
+static Board parsePosition(const char* squares) {
+    uint32_t white = 0, black = 0, kings = 0;
+    int sq = 0;
+    for (const char* p = squares; *p && sq < 32; p++) {
+        if (*p == ' ') continue;
+        uint32_t bit = 1u << sq++;
+        if (*p == 'w' || *p == 'W') white |= bit;
+        if (*p == 'b' || *p == 'B') black |= bit;
+        if (*p == 'W' || *p == 'B') kings |= bit;
+    }
+    return makeBoard(white, black, kings);
+}
+
+static uint64_t perftGenerator(Board& board, bool isWhite, int depth) {
+    MoveList list;
+    board.generateMoves(isWhite, -1, list);
+    if (depth == 1) return list.count;
+    uint64_t nodes = 0;
+    for (const Move& move : list) {
+        UndoRecord undo;
+        board.applyMove(move, isWhite, undo);
+        nodes += perftGenerator(board, !isWhite, depth - 1);
+        board.undoMove(move, isWhite, undo);
+    }
+    return nodes;
+}
+
+// Każdy skok to kopia gry, tak jak serwer widzi kolejne komunikaty MOVE; po zakończonej
+// turze zmienia gracza na posunięciu tak samo jak handleMove.
+static uint64_t perftGame(const Game& game, int depth) {
+    if (depth == 0) return 1;
+    bool isWhite = game.getCurrentPlayer() == 1;
+    PlayerId player = isWhite ? 0 : 1;
+    const Board& board = game.getBoard();
+    uint64_t nodes = 0;
+    for (uint32_t pieces = board.own(isWhite); pieces; pieces &= pieces - 1) {
+        int from = __builtin_ctz(pieces);
+        for (int to = 0; to < 32; to++) {
+            Game next = game;
+            if (!next.isValidMove(squareRow(from), squareCol(from), squareRow(to), squareCol(to), isWhite)) continue;
+            next.makeMove(squareRow(from), squareCol(from), squareRow(to), squareCol(to), player);
+            if (next.isCaptureChainPending()) {
+                nodes += perftGame(next, depth);
+            } else {
+                next.setCurrentPlayer(isWhite ? 2 : 1);
+                nodes += perftGame(next, depth - 1);
+            }
+        }
+    }
+    return nodes;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void printUsage(const char* program) {
+    fprintf(stderr, "Użycie: %s [--depth=N] [--game-depth=N] [--position=NAZWA]\n", program);
+    fprintf(stderr, "  --depth=N       maksymalna głębokość dla generatora (domyślnie: znane wartości)\n");
+    fprintf(stderr, "  --game-depth=N  głębokość dla ścieżki Game::isValidMove/makeMove (domyślnie 4, 0 = pomiń)\n");
+    fprintf(stderr, "  --position=N    tylko pozycja o tej nazwie\n");
+}
+
+int main(int argc, char** argv) {
+    int maxDepth = 0;
+    int gameDepth = 4;
+    const char* only = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--depth=", 8) == 0) {
+            maxDepth = atoi(argv[i] + 8);
+        } else if (strncmp(argv[i], "--game-depth=", 13) == 0) {
+            gameDepth = atoi(argv[i] + 13);
+        } else if (strncmp(argv[i], "--position=", 11) == 0) {
+            only = argv[i] + 11;
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    int failures = 0;
+    uint64_t totalNodes = 0;
+    double totalSeconds = 0;
+    for (int p = 0; p < POSITION_COUNT; p++) {
+        const PerftPosition& pos = POSITIONS[p];
+        if (only && strcmp(only, pos.name) != 0) continue;
+        Board start = parsePosition(pos.squares);
+        int depthLimit = maxDepth > 0 ? maxDepth : pos.knownDepth;
+        printf("%s (%s na posunięciu)\n", pos.name, pos.whiteToMove ? "białe" : "czarne");
+        printf("  %5s %14s %14s %10s %10s\n", "głęb.", "węzły", "oczekiwane", "czas [s]", "Mn/s");
+
+        for (int depth = 1; depth <= depthLimit; depth++) {
+            Board board = start;
+            auto begin = std::chrono::steady_clock::now();
+            uint64_t nodes = perftGenerator(board, pos.whiteToMove, depth);
+            double seconds = secondsSince(begin);
+            totalNodes += nodes;
+            totalSeconds += seconds;
+
+            bool known = depth <= pos.knownDepth;
+            bool ok = !known || nodes == pos.expected[depth - 1];
+            if (!ok) failures++;
+            if (board.white != start.white || board.black != start.black ||
+                board.kings != start.kings || board.hash != start.hash) {
+                printf("  BŁĄD: undoMove nie przywrócił pozycji na głębokości %d\n", depth);
+                failures++;
+            }
+            char expected[24] = "-";
+            if (known) snprintf(expected, sizeof(expected), "%llu", (unsigned long long)pos.expected[depth - 1]);
+            printf("  %5d %14llu %14s %10.3f %10.2f%s\n", depth, (unsigned long long)nodes, expected,
+                   seconds, seconds > 0 ? nodes / seconds / 1e6 : 0.0, ok ? "" : "  BŁĄD");
+        }
+
+        int checkedGameDepth = gameDepth < depthLimit ? gameDepth : depthLimit;
+        if (checkedGameDepth > 0) {
+            Game game(0, 1);
+            game.setPosition(start, pos.whiteToMove);
+            auto begin = std::chrono::steady_clock::now();
+            uint64_t nodes = perftGame(game, checkedGameDepth);
+            double seconds = secondsSince(begin);
+            uint64_t expected = pos.expected[checkedGameDepth - 1];
+            bool ok = checkedGameDepth > pos.knownDepth || nodes == expected;
+            if (!ok) failures++;
+            printf("  Game::isValidMove/makeMove, głębokość %d: %llu węzłów, %.3f s, %.2f Mn/s%s\n",
+                   checkedGameDepth, (unsigned long long)nodes, seconds,
+                   seconds > 0 ? nodes / seconds / 1e6 : 0.0, ok ? "" : "  BŁĄD");
+        }
+    }
+
+    printf("Razem (generator): %llu węzłów, %.3f s, %.2f Mn/s\n", (unsigned long long)totalNodes, totalSeconds,
+           totalSeconds > 0 ? totalNodes / totalSeconds / 1e6 : 0.0);
+    if (failures) {
+        printf("Niezgodności: %d\n", failures);
+        return 1;
+    }
+    printf("Wszystkie liczby zgodne\n");
+    return 0;
+}
@@ -0,0 +1,308 @@
+// Generator bazy końcówek (analiza wsteczna): dla każdego materiału do --pieces bierek liczy
+// wynik każdej pozycji z białymi na posunięciu i odległość do końca gry w półruchach.
+//
+// Materiały są liczone od najmniejszych: bicie prowadzi do materiału z mniejszą liczbą bierek,
+// a promocja do materiału z mniejszą liczbą pionków, więc ich tablice są już gotowe. Materiał
+// i jego lustrzane odbicie (kolory zamienione) są liczone razem, bo ruch białych w jednym
+// daje pozycję czarnych na posunięciu, czyli pozycję drugiego. Przebieg k ustala pozycje
+// rozstrzygnięte dokładnie po k półruchach: wygrana, gdy któryś ruch prowadzi do przegranej
+// przeciwnika po k - 1; przegrana, gdy wszystkie ruchy dają przeciwnikowi wygraną, najdłuższa
+// po k - 1. Brak ruchu to przegrana po 0. Co zostanie nierozstrzygnięte, jest remisem.
+//
+// Przebieg dzieli zakres indeksów na fragmenty pobierane przez wątki licznikiem atomowym.
+// Wątek tylko czyta tablice i zbiera zmiany lokalnie; zmiany są nanoszone po przebiegu,
+// więc w jego trakcie wszystkie wątki widzą ten sam stan i wynik nie zależy od ich liczby.
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "board.h"
+#include "endgame.h"
+
+struct GeneratorOptions {
+    int pieces = 4;
+    int threads = 0;
+    std::string output = "endgame.tb";
+};
+
+struct Table {
+    Material material;
+    std::vector<uint8_t> values;
+};
+
+// Fragment zakresu indeksów przydzielany wątkowi w jednym przebiegu.
+const uint64_t CHUNK_POSITIONS = 1 << 16;
+
+// Wszystkie materiały z co najmniej jedną bierką każdej strony, w kolejności zależności.
+static std::vector<Material> listMaterials(int maxPieces) {
+    std::vector<Material> materials;
+    for (int total = 2; total <= maxPieces; total++) {
+        for (int men = 0; men <= total; men++) {
+            for (int wm = 0; wm <= men; wm++) {
+                for (int wk = 0; wk <= total - men; wk++) {
+                    Material m{wm, wk, men - wm, total - men - wk};
+                    if (m.whiteMen + m.whiteKings > 0 && m.blackMen + m.blackKings > 0) materials.push_back(m);
+                }
+            }
+        }
+    }
+    return materials;
+}
+
+static void describe(const Material& m, char* out, size_t size) {
+    snprintf(out, size, "%dp%dd-%dp%dd", m.whiteMen, m.whiteKings, m.blackMen, m.blackKings);
+}
+
+class Generator {
+public:
+    Generator(int threads) : threads(threads) {}
+    bool build(const std::vector<Material>& materials);
+    bool write(const std::string& path, int maxPieces) const;
+
+private:
+    int threads;
+    std::vector<std::unique_ptr<Table>> tables;
+    EndgameTablebase base;
+
+    bool solveGroup(Table* group[2], int count);
+    void scan(Table& table, uint64_t begin, uint64_t end, int pass, std::vector<std::pair<uint64_t, uint8_t>>& updates,
+              int& nextPass) const;
+};
+
+// Rozstrzyga pozycje zakresu po dokładnie pass półruchach. nextPass dostaje najbliższy późniejszy
+// przebieg, w którym pozostałe pozycje mogłyby się rozstrzygnąć dzięki już znanym wynikom.
+void Generator::scan(Table& table, uint64_t begin, uint64_t end, int pass,
+                     std::vector<std::pair<uint64_t, uint8_t>>& updates, int& nextPass) const {
+    MoveList moves;
+    for (uint64_t index = begin; index < end; index++) {
+        if (table.values[index] != TABLEBASE_DRAW) continue;
+        Board board = tablebasePosition(table.material, index);
+        board.generateMoves(true, -1, moves);
+        int distance = -1;
+        if (moves.count == 0) {
+            distance = 0;
+        } else {
+            // W trakcie budowy zero w tablicy grupy to pozycja jeszcze nierozstrzygnięta.
+            int fastestWin = TABLEBASE_MAX_DISTANCE + 1;
+            int slowestLoss = -1;
+            bool allLose = true;
+            for (const Move& move : moves) {
+                Board next = board;
+                UndoRecord undo;
+                next.applyMove(move, true, undo);
+                TablebaseProbe reply = base.probe(next, false);
+                if (reply.result == TB_LOSS) fastestWin = std::min(fastestWin, reply.distance + 1);
+                else if (reply.result == TB_WIN) slowestLoss = std::max(slowestLoss, reply.distance + 1);
+                else allLose = false;
+            }
+            if (fastestWin == pass) distance = pass;
+            else if (fastestWin > TABLEBASE_MAX_DISTANCE && allLose && slowestLoss == pass) distance = pass;
+            else if (fastestWin <= TABLEBASE_MAX_DISTANCE) nextPass = std::min(nextPass, fastestWin);
+            else if (allLose) nextPass = std::min(nextPass, slowestLoss);
+        }
+        if (distance == pass) updates.push_back({index, uint8_t(distance + 1)});
+    }
+}
+
+bool Generator::solveGroup(Table* group[2], int count) {
+    for (int i = 0; i < count; i++) base.attach(group[i]->material, group[i]->values.data());
+    uint64_t chunks[2] = {0, 0};
+    for (int i = 0; i < count; i++) chunks[i] = (group[i]->values.size() + CHUNK_POSITIONS - 1) / CHUNK_POSITIONS;
+    uint64_t totalChunks = chunks[0] + (count > 1 ? chunks[1] : 0);
+    for (int pass = 0;; pass++) {
+        if (pass > TABLEBASE_MAX_DISTANCE) {
+            fprintf(stderr, "Odległość przekracza %d półruchów, format bazy jej nie zmieści\n", TABLEBASE_MAX_DISTANCE);
+            return false;
+        }
+        std::atomic<uint64_t> nextChunk{0};
+        std::mutex updatesMutex;
+        int nextPass = TABLEBASE_MAX_DISTANCE + 1;
+        std::vector<std::pair<int, std::vector<std::pair<uint64_t, uint8_t>>>> updates;
+        auto work = [&] {
+            std::vector<std::pair<uint64_t, uint8_t>> local[2];
+            int localNext = TABLEBASE_MAX_DISTANCE + 1;
+            uint64_t chunk;
+            while ((chunk = nextChunk.fetch_add(1, std::memory_order_relaxed)) < totalChunks) {
+                int t = chunk < chunks[0] ? 0 : 1;
+                uint64_t first = (t == 0 ? chunk : chunk - chunks[0]) * CHUNK_POSITIONS;
+                uint64_t last = std::min<uint64_t>(first + CHUNK_POSITIONS, group[t]->values.size());
+                scan(*group[t], first, last, pass, local[t], localNext);
+            }
+            std::lock_guard<std::mutex> lock(updatesMutex);
+            nextPass = std::min(nextPass, localNext);
+            for (int t = 0; t < 2; t++) {
+                if (!local[t].empty()) updates.push_back({t, std::move(local[t])});
+            }
+        };
+        std::vector<std::thread> workers;
+        for (int t = 1; t < threads; t++) workers.emplace_back(work);
+        work();
+        for (auto& worker : workers) worker.join();
+
+        size_t resolved = 0;
+        for (const auto& batch : updates) {
+            for (const auto& update : batch.second) group[batch.first]->values[update.first] = update.second;
+            resolved += batch.second.size();
+        }
+        if (resolved > 0) continue;
+        // Bez zmian stan się nie zmienił, więc przebiegi przed nextPass niczego by nie rozstrzygnęły.
+        if (nextPass > TABLEBASE_MAX_DISTANCE) break;
+        pass = std::max(pass, nextPass - 1);
+    }
+    return true;
+}
+
+bool Generator::build(const std::vector<Material>& materials) {
+    std::vector<char> done(materials.size(), 0);
+    for (size_t i = 0; i < materials.size(); i++) {
+        if (done[i]) continue;
+        Table* group[2];
+        int count = 0;
+        for (size_t j = i; j < materials.size(); j++) {
+            if (j == i || (!done[j] && materials[j] == materials[i].flipped())) {
+                done[j] = 1;
+                tables.push_back(std::make_unique<Table>());
+                tables.back()->material = materials[j];
+                tables.back()->values.assign(tablebaseSize(materials[j]), TABLEBASE_DRAW);
+                group[count++] = tables.back().get();
+            }
+        }
+        auto start = std::chrono::steady_clock::now();
+        if (!solveGroup(group, count)) return false;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (int t = 0; t < count; t++) {
+            uint64_t wins = 0, losses = 0, longest = 0;
+            for (uint8_t value : group[t]->values) {
+                if (value == TABLEBASE_DRAW) continue;
+                TablebaseProbe probe = decodeTablebaseValue(value);
+                if (probe.result == TB_WIN) wins++;
+                else losses++;
+                longest = std::max<uint64_t>(longest, probe.distance);
+            }
+            char name[32];
+            describe(group[t]->material, name, sizeof(name));
+            size_t size = group[t]->values.size();
+            printf("%-12s pozycje %12zu  wygrane %5.1f%%  przegrane %5.1f%%  remisy %5.1f%%  najdłużej %3llu  %.2f s\n",
+                   name, size, 100.0 * wins / size, 100.0 * losses / size, 100.0 * (size - wins - losses) / size,
+                   (unsigned long long)longest, seconds);
+            fflush(stdout);
+        }
+    }
+    return true;
+}
+
+static void putU32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out.push_back(uint8_t(value >> (8 * i)));
+}
+
+static void putU64(std::vector<uint8_t>& out, uint64_t value) {
+    putU32(out, uint32_t(value));
+    putU32(out, uint32_t(value >> 32));
+}
+
+static bool writeAll(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        size -= size_t(written);
+    }
+    return true;
+}
+
+// Zapis obok i rename: serwer, który właśnie mapuje starą bazę, nie zobaczy pliku w połowie.
+bool Generator::write(const std::string& path, int maxPieces) const {
+    std::vector<uint8_t> header(TABLEBASE_MAGIC, TABLEBASE_MAGIC + sizeof(TABLEBASE_MAGIC));
+    putU32(header, uint32_t(maxPieces));
+    putU32(header, uint32_t(tables.size()));
+    uint64_t offset = 16 + tables.size() * 24;
+    std::vector<uint64_t> offsets;
+    for (const auto& table : tables) {
+        offset = (offset + 63) & ~uint64_t(63);
+        offsets.push_back(offset);
+        const Material& m = table->material;
+        header.push_back(uint8_t(m.whiteMen));
+        header.push_back(uint8_t(m.whiteKings));
+        header.push_back(uint8_t(m.blackMen));
+        header.push_back(uint8_t(m.blackKings));
+        putU32(header, 0);
+        putU64(header, offset);
+        putU64(header, table->values.size());
+        offset += table->values.size();
+    }
+    std::string tmpPath = path + ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool ok = writeAll(fd, header.data(), header.size());
+    uint64_t position = header.size();
+    static const uint8_t padding[64] = {};
+    for (size_t i = 0; ok && i < tables.size(); i++) {
+        ok = writeAll(fd, padding, size_t(offsets[i] - position)) &&
+             writeAll(fd, tables[i]->values.data(), tables[i]->values.size());
+        position = offsets[i] + tables[i]->values.size();
+    }
+    ok = ok && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+static void printUsage(const char* program) {
+    fprintf(stderr, "Użycie: %s [--pieces=N] [--threads=N] [--output=PLIK]\n", program);
+    fprintf(stderr, "  --pieces=N    największa liczba bierek na planszy (domyślnie 4, najwyżej %d)\n", TABLEBASE_MAX_PIECES);
+    fprintf(stderr, "  --threads=N   wątki generatora (domyślnie po jednym na rdzeń)\n");
+    fprintf(stderr, "  --output=P    plik wynikowy (domyślnie endgame.tb)\n");
+}
+
+int main(int argc, char** argv) {
+    GeneratorOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--pieces=", 0) == 0) options.pieces = atoi(arg.c_str() + 9);
+        else if (arg.rfind("--threads=", 0) == 0) options.threads = atoi(arg.c_str() + 10);
+        else if (arg.rfind("--output=", 0) == 0) options.output = arg.substr(9);
+        else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.pieces < 2 || options.pieces > TABLEBASE_MAX_PIECES || options.output.empty()) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    if (options.threads <= 0) options.threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<Material> materials = listMaterials(options.pieces);
+    uint64_t positions = 0;
+    for (const Material& m : materials) positions += tablebaseSize(m);
+    printf("Materiały: %zu, pozycje: %llu (%.1f MB), wątki: %d\n", materials.size(),
+           (unsigned long long)positions, positions / 1048576.0, options.threads);
+    auto start = std::chrono::steady_clock::now();
+    Generator generator(options.threads);
+    if (!generator.build(materials)) return 1;
+    if (!generator.write(options.output, options.pieces)) {
+        perror("Zapis bazy nie powiódł się");
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("Zapisano %s w %.1f s\n", options.output.c_str(), seconds);
+    return 0;
+}